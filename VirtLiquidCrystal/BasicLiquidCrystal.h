@@ -0,0 +1,1951 @@
+/**
+ * @file BasicLiquidCrystal.h
+ * @brief HD44780 LCD API with the bus transport resolved at compile time.
+ *
+ * BasicLiquidCrystal<Transport> implements the whole LCD command set on top of
+ * a transport class it derives from. All transport calls are made through this->,
+ * so with a concrete transport (ParallelBus, PCF8574Bus) the write path inlines
+ * down to pin or bus operations, and with VirtTransport they become virtual calls
+ * (see VirtLiquidCrystal).
+ *
+ * A transport provides:
+ * - uint8_t beginTransport() Set up the bus, false if the LCD can't be reached
+ * - uint8_t bitMode() LCD_4BIT_MODE or LCD_8BIT_MODE
+ * - void send(uint8_t value, uint8_t mode) Strobe a COMMAND, LCD_DATA or FOUR_BITS value
+ * - void sendBuffer(const uint8_t *buffer, size_t size) Strobe a run of data bytes
+ * - bool canReadStatus() and uint8_t readStatus() Busy flag access
+ * - void setStatusPolling(bool enable) Wait on the busy flag instead of the execution time before each strobe
+ * - void setBacklightPin(uint8_t pin, t_backlighPol pol) and void setBacklight(uint8_t value)
+ * - uint8_t controllers() 2 for displays with two HD44780 (40x4), else 1
+ * - void selectController(uint8_t mask) Enable line(s) the next operations strobe
+ * - uint8_t interleaveBytes() Bytes per controller turn in a dual controller refresh, 0 for whole runs
+ * - void drainTransport() Wait until what was sent has reached the LCD, for buses that queue transfers
+ * - with LCD_STATS, void transportStats(lcd_stats_t *stats) and void resetTransportStats()
+ */
+
+#ifndef _BasicLiquidCrystal_H_
+#define _BasicLiquidCrystal_H_
+
+#if (ARDUINO < 100)
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#endif
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#include <string.h>
+#include <inttypes.h>
+#include <Print.h>
+
+
+#ifdef __AVR__
+#define FAST_MODE
+#endif
+
+/** @defgroup LCD_Commands
+ *  @brief LCD command definitions shouldn't be used unless you are writing a driver.
+ *  @note All these definitions are for driver implementation only and shouldn't be used by applications.
+ */
+#define LCD_CLEAR_DISPLAY 0x01   //& (1<<0)
+#define LCD_RETURN_HOME 0x02     //& (1<<1)
+#define LCD_ENTRY_MODE_SET 0x04  //& (1<<2)
+#define LCD_DISPLAY_CONTROL 0x08 //& (1<<3)
+#define LCD_CURSOR_SHIFT 0x10    //& (1<<4)
+#define LCD_FUNCTION_SET 0x20    //& (1<<5)
+#define LCD_SET_CGRAM_ADDR 0x40  //& (1<<6)
+#define LCD_SET_DDRAM_ADDR 0x80  //& (1<<7)
+
+/** @defgroup flags for display entry mode
+ *  Flags for setting the text entry mode
+ */
+#define LCD_ENTRY_RIGHT 0x00
+#define LCD_ENTRY_LEFT 0x02
+#define LCD_ENTRY_SHIFT_INCREMENT 0x01 
+#define LCD_ENTRY_SHIFT_DECREMENT 0x00 
+
+/** @defgroup flags for display on/off and blink control
+ *  Flags for turning the display on/off and controlling the blink and cursor
+ */
+#define LCD_DISPLAY_ON 0x04   //& 
+#define LCD_DISPLAY_OFF 0x00  
+#define LCD_CURSOR_ON 0x02 //& 
+#define LCD_CURSOR_OFF 0x00
+#define LCD_BLINK_ON 0x01 //& 
+#define LCD_BLINK_OFF 0x00
+
+/** @defgroup flags for display/cursor shift
+ *  Flags for shifting the display or cursor
+ */
+#define LCD_DISPLAY_MOVE 0x08  //& 
+#define LCD_CURSOR_MOVE 0x00   //& 
+#define LCD_MOVE_RIGHT 0x04  //& 
+#define LCD_MOVE_LEFT 0x00  //& 
+
+/** @defgroup flags for function set
+ *  Flags for setting the function of the display
+ */
+#define LCD_8BIT_MODE 0x10  //& 
+#define LCD_4BIT_MODE 0x00  //& 
+#define LCD_2_LINE 0x08     //& 
+#define LCD_1_LINE 0x00     //& 
+#define LCD_5x10DOTS 0x04   //& 
+#define LCD_5x8DOTS 0x00    //& 
+
+/** @defgroup flags for backlight control
+ *  Flags for controlling the backlight of the display
+ */
+#define LCD_BACKLIGHT_ON 0x08
+#define LCD_BACKLIGHT_OFF 0x00 
+// flags for backlight control
+#define LCD_NOBACKLIGHT 0x00
+#define LCD_BACKLIGHT 0xFF //
+
+/** @defgroup Define COMMAND and LCD_DATA LCD Rs (used by send method).
+ *  Constants for distinguishing between commands and data sent to the LCD
+ */
+#define COMMAND 0
+#define LCD_DATA 1
+#define FOUR_BITS 2
+
+#define HOME_CLEAR_EXEC 2000
+
+/** @brief Busy flag bit of the status register (DB7) */
+#define LCD_BUSY_FLAG 0x80
+
+/** @brief Number of operations the asynchronous mode can hold, see setAsync() */
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 16
+#endif
+
+/** @brief Bytes needed by setFramebuffer() for a cols x rows display
+ *  (the cells to show plus a copy of what the LCD currently shows)
+ */
+#define LCD_FRAMEBUFFER_SIZE(cols, rows) (2 * (cols) * (rows))
+
+/** @brief Bytes needed by setDoubleBuffer() for a cols x rows display
+ *  (back, pending and front cells plus a copy of what the LCD currently shows)
+ */
+#define LCD_DOUBLE_BUFFER_SIZE(cols, rows) (4 * (cols) * (rows))
+
+/** @brief Flag of the pending buffer index: published and not taken by flush() yet */
+#define LCD_FB_FRESH 0x80
+
+/** @brief Number of characters the LCD holds in DDRAM, split in 2 lines of 40 in 2 line mode */
+#define LCD_DDRAM_SIZE 80
+
+/** @brief Rows a single HD44780 addresses */
+#define LCD_MAX_ROWS 4
+
+/** @brief Controller selection of dual controller (40x4) displays.
+ *  Controller 1 shows rows 0-1, controller 2 rows 2-3.
+ */
+#define LCD_CONTROLLER_1 0x01
+#define LCD_CONTROLLER_2 0x02
+#define LCD_CONTROLLERS_ALL 0x03
+
+/** @brief Controller register content unknown, the next setter sends it */
+#define LCD_NO_STATE 0xFF
+
+/** @brief Address counter position unknown (CGRAM selected or out of range) */
+#define LCD_NO_ADDR 0xFF
+
+/** @brief Number of custom characters the LCD holds in CGRAM */
+#define LCD_CGRAM_SLOTS 8
+
+/** @brief CGRAM slot not holding a glyph of the glyph cache */
+#define LCD_NO_GLYPH 0xFF
+
+/** @brief DDRAM layout of a display, see setRowOffsets() */
+typedef struct
+{
+  uint8_t cols;
+  uint8_t rows;
+  uint8_t splitCol;                 // First column on the second controller line, 0 for none
+  uint8_t rowOffsets[LCD_MAX_ROWS]; // DDRAM address of the first column of each row
+} lcd_geometry_t;
+
+typedef enum
+{
+  POSITIVE,
+  NEGATIVE
+} t_backlighPol;
+
+typedef enum
+{
+  DISPLAY_ON,
+  DISPLAY_OFF,
+  CURSOR_ON,
+  CURSOR_OFF,
+  BLINK_ON,
+  BLINK_OFF,
+  SCROLL_LEFT,
+  SCROLL_RIGHT,
+  LEFT_TO_RIGHT,
+  RIGHT_TO_LEFT,
+  AUTOSCROLL_ON,
+  AUTOSCROLL_OFF,
+  BACKLIGHT_ON,
+  BACKLIGHT_OFF,
+} lcd_mode_t;
+
+/** @brief Queued LCD operation (asynchronous mode) */
+typedef struct
+{
+  uint8_t value;     // Command or data byte
+  uint8_t mode;      // COMMAND, LCD_DATA or FOUR_BITS, controllers in the high nibble
+  uint16_t execTime; // Microseconds the LCD needs before the next operation
+} lcd_op_t;
+
+/** @brief Define LCD_STATS in the build flags to count the activity of each display
+ *  @note It must be seen by every file of the library, not only by the sketch.
+ */
+#ifdef LCD_STATS
+typedef struct
+{
+  uint32_t commands;        // Instructions sent
+  uint32_t dataBytes;       // Characters and CGRAM bytes sent
+  uint32_t sends;           // Transport send() and sendBuffer() calls
+  uint32_t waitMicros;      // Execution time requested by what was sent
+  uint32_t i2cTransactions; // I2C transports only
+  uint32_t i2cNacks;        // Transactions the expander didn't acknowledge
+} lcd_stats_t;
+
+#define LCD_STAT(x) x
+#else
+#define LCD_STAT(x)
+#endif
+
+template <class Transport>
+class BasicLiquidCrystal : public Print, public Transport
+{
+public:
+  BasicLiquidCrystal()
+      : _displayfunction(0), _displaycontrol(0), _displaymode(0), _polarity(POSITIVE),
+        _initialized(false), _framebuffer(NULL), _async(false), _busyPolling(false),
+        _glyphs(NULL), _glyphCount(0){};
+
+  uint8_t init(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
+
+  void begin();
+
+  /** @brief Clear the display */
+  void clear();
+
+  /** @brief Move the cursor to the home position */
+  void home();
+
+  /** @brief Send the whole controller state again
+   *
+   *  State setters skip commands that wouldn't change anything, this runs the
+   *  interface length sequence of begin() again and forces function set,
+   *  display control and entry mode out after a suspected controller reset
+   *  (brown-out, ESD). Cached glyphs are reloaded and the next
+   *  flush() redraws the whole framebuffer. Characters set with createChar()
+   *  must be set again by the caller.
+   */
+  void resync();
+
+  /** @brief Turn off the display */
+  void noDisplay();
+
+  /** @brief Turn on the display */
+  void display();
+
+  /**
+   * @brief set display modes
+   *
+   * @param mode
+   * - DISPLAY_ON Turn the display on
+   * - DISPLAY_OFF Turn the display off
+   * - CURSOR_ON Turns the underline cursor on
+   * - CURSOR_OFF Turns the underline cursor off
+   * - BLINK_ON Turn the blinking cursor on
+   * - BLINK_OFF Turn the blinking cursor off
+   * - SCROLL_LEFT These command scroll the display without changing the RAM
+   * - SCROLL_RIGHT These commands scroll the display without changing the RAM
+   * - LEFT_TO_RIGHT This is for text that flows Left to Right
+   * - RIGHT_TO_LEFT This is for text that flows Right to Left
+   * - AUTOSCROLL_ON This will 'right justify' text from the cursor
+   * - AUTOSCROLL_OFF This will 'left justify' text from the cursor
+   *
+   */
+  void display(lcd_mode_t mode);
+
+  /** @brief Turn off the blink */
+  void noBlink();
+
+  /** @brief Turn on the blink */
+  void blink();
+
+  /** @brief Turn off the cursor */
+  void noCursor();
+
+  /** @brief Turn on the cursor */
+  void cursor();
+
+  /** @brief Scroll the display left */
+  void scrollDisplayLeft(); 
+
+  /** @brief Scroll the display right */
+  void scrollDisplayRight(); 
+
+  /** @brief Set the text direction to left-to-right */
+  void leftToRight();
+
+  /** @brief Set the text direction to right-to-left */
+  void rightToLeft();
+
+  void moveCursorRight();
+  void moveCursorLeft();
+
+  /** @brief Turn on autoscrolling */
+  void autoscroll();
+
+  /** @brief Turn off autoscrolling */
+  void noAutoscroll();
+
+  /** @brief Create a custom character
+   *
+   *  @param location Location of the custom character
+   *  @param charmap Character map for the custom character
+   */
+  void createChar(uint8_t location, const uint8_t charmap[]);
+
+#ifdef __AVR__
+  void createChar(uint8_t location, const char *charmap);
+#endif // __AVR__
+
+  /** @brief Create consecutive custom characters in a single CGRAM burst
+   *
+   *  The CGRAM address is set once and all the rows are streamed with the
+   *  transport's bulk path, which is much cheaper than one createChar() each.
+   *
+   *  @param location First custom character location
+   *  @param charmaps Character maps, 8 rows each
+   *  @param count Number of characters, clipped to the locations left after location
+   */
+  void createChars(uint8_t location, const uint8_t (*charmaps)[8], uint8_t count);
+
+  /** @brief Register the custom characters of the glyph cache
+   *
+   *  The LCD only holds LCD_CGRAM_SLOTS custom characters. glyph() maps any
+   *  number of them onto the slots, uploading a glyph only when it isn't loaded.
+   *
+   *  @param glyphs Table of 8 row bitmaps indexed by glyph ID, NULL disables the cache
+   *  @param count Number of glyphs in the table
+   */
+  void setGlyphs(const uint8_t (*glyphs)[8], uint8_t count);
+
+  /** @brief Character code showing a registered glyph
+   *
+   *  On a miss the least recently used slot that isn't on screen is reloaded.
+   *  What is on screen is only known with a framebuffer: without one the least
+   *  recently used slot is reloaded even if cells still show it, and they then
+   *  change to the new glyph. An upload points the LCD back at the DDRAM address
+   *  it was at, so write(glyph(id)) lands at the cursor.
+   *
+   *  @param id Index of the glyph in the setGlyphs() table
+   *  @return Code to print, 0 to LCD_CGRAM_SLOTS - 1, or a space for an unknown ID
+   */
+  uint8_t glyph(uint8_t id);
+
+  /** @brief Set the cursor position
+   *
+   *  @param col Column position of the cursor
+   *  @param row Row position of the cursor
+   */
+  void setCursor(uint8_t col, uint8_t row);
+
+  /** @brief Override the DDRAM address of the first column of each row
+   *
+   *  init() already picks the layout of the common geometries, this is for
+   *  panels wired differently.
+   *
+   *  @param splitCol Columns from this one on are on the second controller line
+   *  (16x1 panels are 8x2 internally), 0 if the rows aren't split
+   */
+  void setRowOffsets(uint8_t row0, uint8_t row1, uint8_t row2 = 0, uint8_t row3 = 0, uint8_t splitCol = 0);
+
+  /** @brief Attach a shadow framebuffer
+   *
+   *  While a framebuffer is attached print(), write(), setCursor(), clear() and
+   *  home() only update RAM; nothing is sent to the LCD until flush().
+   *
+   *  @param buffer At least LCD_FRAMEBUFFER_SIZE(cols, rows) bytes, NULL detaches it
+   */
+  void setFramebuffer(uint8_t *buffer);
+
+  /** @brief Attach a framebuffer drawn by one task and flushed by another
+   *
+   *  Like setFramebuffer(), but print(), write(), setCursor(), clear() and home()
+   *  draw into a back buffer that flush() never reads. swapBuffers() publishes it
+   *  and flush() sends the latest frame published, so the LCD only ever shows
+   *  whole frames and the drawing task never waits for the bus.
+   *  A third buffer holds the frame in between: the drawing task and the display
+   *  task each own one buffer and trade with the pending one by an atomic
+   *  exchange of its index. Drawing calls belong to one task, flush() and every
+   *  other call to the display task.
+   *
+   *  @param buffer At least LCD_DOUBLE_BUFFER_SIZE(cols, rows) bytes, NULL detaches it
+   */
+  void setDoubleBuffer(uint8_t *buffer);
+
+  /** @brief Publish the back buffer for the next flush()
+   *
+   *  A frame published before and not flushed yet is dropped for this one.
+   *  The exchange itself takes constant time, keep adds a copy of cols * rows bytes.
+   *
+   *  @param keep Copy the frame into the new back buffer to keep drawing on it,
+   *  false when every frame is drawn from scratch
+   *  @return false if the previous frame was dropped unshown
+   */
+  bool swapBuffers(bool keep = true);
+
+  /** @brief Send the framebuffer cells that changed since the last flush
+   *
+   *  Adjacent changed cells of a row are grouped into runs so that each run
+   *  costs a single DDRAM address command.
+   *  With setDoubleBuffer() it first takes the frame last published, if any.
+   */
+  void flush();
+
+  /** @brief Cap the frames per second refresh() sends
+   *
+   *  @param fps 0 (default) lets every refresh() flush
+   */
+  void setMaxFps(uint8_t fps);
+
+  /** @brief flush() if a frame is due
+   *
+   *  Call it as often as values change: writes only land in the framebuffer,
+   *  where the latest value of a cell replaces any earlier one, and at most
+   *  setMaxFps() frames per second reach the bus. Frames keep a steady cadence
+   *  and, as a frame never sends more than every cell, the share of the bus the
+   *  display takes stays bounded whatever the update rate.
+   *
+   *  @return true if it flushed
+   */
+  bool refresh();
+
+  /** @brief Turn on the backlight */
+  void backlight(void);
+
+  /** @brief Turn off the backlight */
+  void noBacklight(void);
+
+  /** @brief Turn on the display */
+  void on(void);
+
+  /** @brief Turn off the display */
+  void off(void);
+
+  /** @brief Queue commands instead of blocking on their execution time
+   *
+   *  In asynchronous mode every command and character is put into a ring of
+   *  LCD_QUEUE_SIZE operations and poll() sends them once the LCD is ready.
+   *  If the ring is full the caller blocks until a slot frees up.
+   *  Switching back to synchronous mode drains the queue.
+   *
+   *  @param async true to queue, false to block (default)
+   */
+  void setAsync(bool async);
+
+  /** @brief Send queued operations whose execution deadline has passed
+   *
+   *  Call from the main loop while in asynchronous mode.
+   *
+   *  @param maxOps Send at most this many operations, LCDScheduler takes turns of 1
+   *  @return true while operations are still pending
+   */
+  bool poll(uint8_t maxOps = LCD_QUEUE_SIZE);
+
+  /** @brief Number of operations waiting in the asynchronous queue */
+  uint8_t queued() { return (uint8_t)((_qHead + LCD_QUEUE_SIZE - _qTail) % LCD_QUEUE_SIZE); };
+
+  /** @brief Wait on the LCD busy flag instead of worst case execution times
+   *
+   *  Needs the R/W line wired. Commands and characters then complete as soon as
+   *  the controller reports ready; the datasheet delays remain as an upper bound.
+   *  Over I2C a single status read takes several transactions, about 2ms at
+   *  100kHz, far longer than the 37us most instructions take: it only pays off
+   *  for clear() and home(), and at high bus clocks.
+   *
+   *  @param enable true to poll the busy flag, false to use fixed delays (default)
+   *  @return false if the driver can't read the busy flag
+   */
+  bool setBusyFlagPolling(bool enable);
+
+  void waitMicroseconds(uint32_t cmdDelay);
+
+#ifdef LCD_STATS
+  /** @brief Snapshot of the activity counters since init() or resetStats() */
+  lcd_stats_t getStats();
+
+  /** @brief Zero the activity counters */
+  void resetStats();
+#endif
+
+  //& Print methods --------------------------------------------------------------------------
+
+#if (ARDUINO < 100)
+  virtual void write(uint8_t value);
+  virtual void write(const uint8_t *buffer, size_t size);
+#else
+  virtual size_t write(uint8_t value);
+  virtual size_t write(const uint8_t *buffer, size_t size);
+#endif
+  using Print::write;
+
+  //   //& Internal LCD variables to control the LCD shared between all derived classes. --------------------------------------------------------------------------
+
+  uint8_t _displayfunction; // LCD_5x10DOTS or LCD_5x8DOTS, LCD_4BIT_MODE or LCD_8BIT_MODE, LCD_1_LINE or LCD_2_LINE
+  uint8_t _displaycontrol;  // LCD base control command LCD on/off, blink, cursor all commands are "ored" to its contents.
+  uint8_t _displaymode;     // Text entry mode to the LCD
+  uint8_t _sentControl;     // _displaycontrol last sent to the LCD, or LCD_NO_STATE
+  uint8_t _sentMode;        // Entry mode last sent to the LCD, or LCD_NO_STATE
+
+  uint8_t _charsize;
+  uint8_t _rows;
+  uint8_t _cols;
+
+  uint8_t _rowOffsets[LCD_MAX_ROWS]; // DDRAM address of the first column of each row
+  uint8_t _splitCol;                 // First column on the second controller line, 0xFF if none
+
+  t_backlighPol _polarity;
+  uint8_t _backlightValue;
+  // uint8_t _backlightPin;
+
+  uint8_t _En; //_enable_pin // 
+  uint8_t _Rw; // _rw_pin // R/W pin
+  uint8_t _Rs; // _rs_pin//  Register Select pin
+
+protected:
+  /** @brief DDRAM address of a cell */
+  uint8_t ddramAddress(uint8_t col, uint8_t row)
+  {
+     return (_rowOffsets[row] + col + ((col >= _splitCol) ? (0x40 - _splitCol) : 0)) & ~LCD_SET_DDRAM_ADDR;
+  };
+
+  uint8_t _initialized;
+
+  uint8_t _ddramAddr;      // DDRAM address the LCD address counter points at, or LCD_NO_ADDR
+  uint8_t _otherDdramAddr; // Same for the inactive controller of a dual controller display
+
+  uint8_t _controllers; // HD44780 driving the display, 2 for 40x4
+  uint8_t _active;      // Controller of the cursor, LCD_CONTROLLER_1 or LCD_CONTROLLER_2
+  uint8_t _target;      // Controllers the next operation goes to
+  uint8_t _cursorCtrl;  // Controller last sent the cursor and blink bits
+
+  uint8_t *_framebuffer; // Cells drawn into, the back buffer when double buffered
+  uint8_t *_fbBase;      // Cell buffers followed by the cells shown on the LCD
+  uint8_t *_fbCells;     // Cells flush() sends, the front buffer when double buffered
+  uint8_t *_fbShown;     // Cells shown on the LCD
+  uint8_t _fbBuffers;    // Cell buffers at _fbBase, 1, or 3 when double buffered
+  uint8_t _fbBack;       // Index of the back buffer, owned by the drawing task
+  uint8_t _fbFront;      // Index of the front buffer, owned by flush()
+  volatile uint8_t _fbPending; // Index of the buffer in between, LCD_FB_FRESH once published
+  uint8_t _fbCol;        // Framebuffer cursor column
+  uint8_t _fbRow;        // Framebuffer cursor row
+  bool _fbSynced;        // Shown cells match the LCD
+  uint32_t _framePeriod; // Minimum micros() between two refresh() flushes, 0 for none
+  uint32_t _frameAt;     // micros() the last refresh() flush was due
+
+  lcd_op_t _queue[LCD_QUEUE_SIZE]; // Pending operations (asynchronous mode)
+  uint8_t _qHead;                  // Next free slot
+  uint8_t _qTail;                  // Next operation to send
+  uint32_t _issuedAt;              // micros() when the last operation was sent
+  uint32_t _execTime;              // Execution time of the last operation sent
+  bool _async;
+  bool _busyPolling;
+
+#ifdef LCD_STATS
+  lcd_stats_t _stats;
+#endif
+
+  const uint8_t (*_glyphs)[8];         // Glyph cache bitmaps, by ID
+  uint8_t _glyphCount;
+  uint8_t _slotGlyph[LCD_CGRAM_SLOTS];  // Glyph ID loaded in each CGRAM slot
+  uint16_t _slotUsed[LCD_CGRAM_SLOTS];  // _glyphTick of the last use
+  uint16_t _glyphTick;
+
+  //& PRIVATE--------------------------------------------------------------------------
+
+private:
+  /** @brief Send a command to the LCD
+   *
+   *  @param value Value of the command to send
+   *  @param execTime Microseconds the command takes to execute
+   */
+  void command(uint8_t value, uint16_t execTime = 0);
+
+  /** @brief Send now or queue a byte, depending on the mode */
+  void transmit(uint8_t value, uint8_t mode, uint16_t execTime);
+
+  /** @brief Send now or queue a run of data bytes, depending on the mode */
+  void transmitBuffer(const uint8_t *buffer, size_t size);
+
+  /** @brief Check if the last operation sent in asynchronous mode has finished */
+  bool ready();
+
+  /** @brief Point the LCD address counter at a cell, unless it already is */
+  void setDdramAddress(uint8_t col, uint8_t row);
+
+  /** @brief Follow the address counter over size data bytes written
+   *
+   *  @param left true if it increments, the LCD_ENTRY_LEFT bit of the entry mode sent
+   */
+  void advanceAddress(size_t size, bool left);
+
+  /** @brief Interface length and function set sequence, from power on or a reset */
+  void setInterfaceLength();
+
+  /** @brief Send _displaycontrol unless the LCD already has it */
+  void sendDisplayControl();
+
+  /** @brief Send _displaymode unless the LCD already has it */
+  void sendEntryMode() { sendEntryMode(_displaymode); };
+
+  /** @brief Send an entry mode unless the LCD already has it */
+  void sendEntryMode(uint8_t mode);
+
+  /** @brief Make the controller of a row the one data and cursor commands go to */
+  void activate(uint8_t row);
+
+  /** @brief flush() of dual controller displays, feeding one half while the other executes */
+  void flushInterleaved();
+
+  /** @brief Attach cell buffers followed by the shown cells */
+  void attachFramebuffer(uint8_t *buffer, uint8_t buffers);
+
+  /** @brief Store value as the pending buffer index, returns the previous one */
+  uint8_t exchangePending(uint8_t value);
+
+  /** @brief Store characters at the framebuffer cursor */
+  void writeFramebuffer(const uint8_t *buffer, size_t size);
+
+  /** @brief Set the CGRAM address once and stream count characters of 8 rows */
+  void writeCgram(uint8_t location, const uint8_t *rows, uint8_t count);
+
+  /** @brief Mask of the CGRAM slots used by a framebuffer cell */
+  uint8_t visibleSlots();
+
+#ifdef LCD_STATS
+  /** @brief Account for one operation handed to the transport */
+  void countSend(uint8_t mode, uint16_t execTime);
+#endif
+};
+
+// PUBLIC METHODS
+// ---------------------------------------------------------------------------
+template <class Transport>
+uint8_t BasicLiquidCrystal<Transport>::init(uint8_t cols, uint8_t lines, uint8_t charsize)
+{
+   // Layouts that don't follow the default 0x00, 0x40, cols, 0x40 + cols, in flash on AVR
+   static constexpr lcd_geometry_t geometries[] PROGMEM = {
+       {8, 1, 0, {0x00, 0x40, 0x08, 0x48}},
+       {16, 1, 8, {0x00, 0x40, 0x10, 0x50}}, // 8x2 internally
+       {16, 2, 0, {0x00, 0x40, 0x10, 0x50}},
+       {16, 4, 0, {0x00, 0x40, 0x10, 0x50}},
+       {20, 2, 0, {0x00, 0x40, 0x14, 0x54}},
+       {20, 4, 0, {0x00, 0x40, 0x14, 0x54}},
+       {24, 2, 0, {0x00, 0x40, 0x18, 0x58}},
+       {40, 2, 0, {0x00, 0x40, 0x00, 0x40}},
+       {40, 4, 0, {0x00, 0x40, 0x00, 0x40}}, // rows 2-3 on the second controller
+   };
+
+   _cols = cols;
+   _rows = (lines > LCD_MAX_ROWS) ? LCD_MAX_ROWS : lines;
+   _charsize = charsize;
+
+   setRowOffsets(0x00, 0x40, cols, 0x40 + cols);
+   for (uint8_t i = 0; i < sizeof(geometries) / sizeof(geometries[0]); i++)
+   {
+      lcd_geometry_t geometry;
+#ifdef __AVR__
+      memcpy_P(&geometry, &geometries[i], sizeof(geometry));
+#else
+      geometry = geometries[i];
+#endif
+
+      if ((geometry.cols == cols) && (geometry.rows == lines))
+      {
+         setRowOffsets(geometry.rowOffsets[0], geometry.rowOffsets[1],
+                       geometry.rowOffsets[2], geometry.rowOffsets[3], geometry.splitCol);
+         break;
+      }
+   }
+
+   _displayfunction = this->bitMode() | LCD_1_LINE | charsize;
+   if ((_rows > 1) || (_splitCol < _cols))
+   {
+      _displayfunction |= LCD_2_LINE;
+   }
+
+   _framebuffer = NULL;
+   _framePeriod = 0;
+   _ddramAddr = LCD_NO_ADDR;
+   _otherDdramAddr = LCD_NO_ADDR;
+   _sentControl = LCD_NO_STATE;
+   _sentMode = LCD_NO_STATE;
+
+   _controllers = 1;
+   _active = LCD_CONTROLLER_1;
+   _target = LCD_CONTROLLERS_ALL;
+   _cursorCtrl = LCD_CONTROLLER_1;
+
+   _async = false;
+   _busyPolling = false;
+   _qHead = 0;
+   _qTail = 0;
+
+   LCD_STAT(resetStats());
+
+   setGlyphs(NULL, 0);
+
+   _initialized = true;
+   return _initialized;
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::begin()
+{  
+   if (!_initialized || !this->beginTransport())
+   {
+      return;
+   }
+
+   // The transport may have been switched to another interface length since init()
+   _displayfunction = (_displayfunction & ~LCD_8BIT_MODE) | this->bitMode();
+
+   // Everything up to the first setCursor() goes to both controllers
+   _controllers = this->controllers();
+   _active = LCD_CONTROLLER_1;
+   _target = LCD_CONTROLLERS_ALL;
+   _cursorCtrl = LCD_CONTROLLER_1;
+   if (_controllers > 1)
+   {
+      _busyPolling = false; // which controller to poll is ambiguous
+   }
+   
+   // for some 1 line displays you can select a 10 pixel high font
+   // ------------------------------------------------------------
+   if ((_charsize != LCD_5x8DOTS) && (_rows == 1))
+   {
+      _displayfunction |= LCD_5x10DOTS;
+   }
+
+
+   // ---------------------------------------------------------------------------
+   // delay (100); // 100ms delay
+   _qHead = 0;
+   _qTail = 0;
+   if (_async)
+   {
+      _issuedAt = micros();
+      _execTime = 100000UL;
+   }
+   else
+   {
+      waitMicroseconds(100000UL);
+   }
+
+   _ddramAddr = LCD_NO_ADDR;
+   _otherDdramAddr = LCD_NO_ADDR;
+   _sentControl = LCD_NO_STATE;
+   _sentMode = LCD_NO_STATE;
+
+   setInterfaceLength();
+
+   // turn the display on with no cursor or blinking default
+   _displaycontrol = LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF;
+   display();
+
+   command(LCD_CLEAR_DISPLAY, HOME_CLEAR_EXEC);
+   _ddramAddr = 0;
+   _otherDdramAddr = 0;
+   _fbSynced = false;
+
+   // CGRAM content is lost with the power
+   memset(_slotGlyph, LCD_NO_GLYPH, sizeof(_slotGlyph));
+
+   _displaymode = LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT;
+   sendEntryMode();
+
+   backlight();
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setInterfaceLength()
+{
+   // The busy flag can't be read until the interface length is set
+   bool busyPolling = _busyPolling;
+   _busyPolling = false;
+   this->setStatusPolling(false);
+
+   // put the LCD into 4 bit or 8 bit mode
+   //  -------------------------------------
+
+   if (!(_displayfunction & LCD_8BIT_MODE))
+   {
+    
+      transmit(0x03, FOUR_BITS, 4500); // wait min 4.1ms
+
+      // second try
+      transmit(0x03, FOUR_BITS, 150); // waitMicroseconds min 100us
+
+      // third go!
+      transmit(0x03, FOUR_BITS, 150); // waitMicroseconds min of 100us
+
+      // finally, set to 4-bit interface
+      transmit(0x02, FOUR_BITS, 150); // waitMicroseconds min of 100us
+   }
+   else
+   {
+      // Send function set command sequence
+      command(LCD_FUNCTION_SET | _displayfunction, 4500); // waitMicroseconds more than 4.1ms
+
+      // second try
+      command(LCD_FUNCTION_SET | _displayfunction, 150);
+
+      // third go
+      command(LCD_FUNCTION_SET | _displayfunction, 150);
+   }
+
+   // finally, set # lines, font size, etc.
+   command(LCD_FUNCTION_SET | _displayfunction, 60); // waitMicroseconds more
+
+   _busyPolling = busyPolling;
+   this->setStatusPolling(busyPolling);
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::resync()
+{
+   // A reset controller is back in 8 bit mode, where a lone function set sent
+   // as two nibbles reads as two instructions
+   _target = LCD_CONTROLLERS_ALL;
+   setInterfaceLength();
+   _target = _active;
+
+   _sentControl = LCD_NO_STATE;
+   _sentMode = LCD_NO_STATE;
+   sendDisplayControl();
+   sendEntryMode();
+
+   // Reload the cached glyphs, writeCgram() forgets which one is where
+   if (_glyphs != NULL)
+   {
+      for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+      {
+         uint8_t id = _slotGlyph[slot];
+
+         if (id != LCD_NO_GLYPH)
+         {
+            writeCgram(slot, _glyphs[id], 1);
+            _slotGlyph[slot] = id;
+         }
+      }
+   }
+
+   _ddramAddr = LCD_NO_ADDR;
+   _otherDdramAddr = LCD_NO_ADDR;
+   _fbSynced = false;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::clear()
+{
+   if (_framebuffer != NULL)
+   {
+      memset(_framebuffer, ' ', _cols * _rows);
+      _fbCol = 0;
+      _fbRow = 0;
+      return;
+   }
+
+   command(LCD_CLEAR_DISPLAY, HOME_CLEAR_EXEC); // clear display, set cursor position to zero, time consuming
+   activate(0);
+   _ddramAddr = 0;
+   _otherDdramAddr = 0;
+
+   // Clear also sets the LCD back to left to right, keep it in line with _displaymode
+   if (_sentMode != LCD_NO_STATE)
+   {
+      _sentMode |= LCD_ENTRY_LEFT;
+   }
+   sendEntryMode();
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::home()
+{
+   if (_framebuffer != NULL)
+   {
+      _fbCol = 0;
+      _fbRow = 0;
+      return;
+   }
+
+   command(LCD_RETURN_HOME, HOME_CLEAR_EXEC); // set cursor position to zero, time consuming
+   activate(0);
+   _ddramAddr = 0;
+   _otherDdramAddr = 0;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setCursor(uint8_t col, uint8_t row)
+{
+   if (row >= _rows)
+   {
+      row = _rows - 1; // rows start at 0
+   }
+
+   if (_framebuffer != NULL)
+   {
+      _fbCol = col;
+      _fbRow = row;
+      return;
+   }
+
+   setDdramAddress(col, row);
+
+   // The cursor is shown by the controller of its row only
+   if ((_cursorCtrl != _active) && (_displaycontrol & (LCD_CURSOR_ON | LCD_BLINK_ON)))
+   {
+      command(LCD_DISPLAY_CONTROL | _displaycontrol);
+   }
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setRowOffsets(uint8_t row0, uint8_t row1, uint8_t row2, uint8_t row3, uint8_t splitCol)
+{
+   _rowOffsets[0] = row0;
+   _rowOffsets[1] = row1;
+   _rowOffsets[2] = row2;
+   _rowOffsets[3] = row3;
+   _splitCol = (splitCol != 0) ? splitCol : 0xFF;
+   _ddramAddr = LCD_NO_ADDR;
+   _otherDdramAddr = LCD_NO_ADDR;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setFramebuffer(uint8_t *buffer)
+{
+   attachFramebuffer(buffer, 1);
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setDoubleBuffer(uint8_t *buffer)
+{
+   attachFramebuffer(buffer, 3);
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::attachFramebuffer(uint8_t *buffer, uint8_t buffers)
+{
+   uint16_t size = _cols * _rows;
+
+   _framebuffer = buffer;
+   _fbBase = buffer;
+   _fbBuffers = buffers;
+   _fbCol = 0;
+   _fbRow = 0;
+   _fbSynced = false; // first flush rewrites every cell
+
+   if (_framebuffer != NULL)
+   {
+      memset(_fbBase, ' ', buffers * size);
+      _fbBack = 0;
+      _fbFront = buffers - 1;
+      _fbPending = 1; // a single buffer is its own front, pending is unused
+      _fbCells = &_fbBase[_fbFront * size];
+      _fbShown = &_fbBase[buffers * size];
+   }
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setMaxFps(uint8_t fps)
+{
+   _framePeriod = (fps != 0) ? (1000000UL / fps) : 0;
+   _frameAt = micros() - _framePeriod; // the next refresh() is due
+}
+
+// Frames are due on a fixed cadence so that a caller a little late doesn't
+// drift the rate down; after an idle spell the cadence restarts from now
+template <class Transport>
+bool BasicLiquidCrystal<Transport>::refresh()
+{
+   if (_framebuffer == NULL)
+   {
+      return false;
+   }
+
+   if (_framePeriod != 0)
+   {
+      uint32_t elapsed = micros() - _frameAt;
+
+      if (elapsed < _framePeriod)
+      {
+         return false;
+      }
+      _frameAt += (elapsed < 2 * _framePeriod) ? _framePeriod : elapsed;
+   }
+
+   flush();
+   return true;
+}
+
+// The drawing task only ever touches the back buffer and the display task
+// the front one, the exchange hands buffers between them
+template <class Transport>
+bool BasicLiquidCrystal<Transport>::swapBuffers(bool keep)
+{
+   if ((_framebuffer == NULL) || (_fbBuffers == 1))
+   {
+      return true;
+   }
+
+   uint8_t *published = _framebuffer;
+   uint8_t previous = exchangePending(_fbBack | LCD_FB_FRESH);
+
+   _fbBack = previous & ~LCD_FB_FRESH;
+   _framebuffer = &_fbBase[_fbBack * _cols * _rows];
+   if (keep)
+   {
+      memcpy(_framebuffer, published, _cols * _rows);
+   }
+   return !(previous & LCD_FB_FRESH);
+}
+
+template <class Transport>
+uint8_t BasicLiquidCrystal<Transport>::exchangePending(uint8_t value)
+{
+   uint8_t previous;
+
+#ifdef __AVR__
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      previous = _fbPending;
+      _fbPending = value;
+   }
+#else
+   previous = __atomic_exchange_n(&_fbPending, value, __ATOMIC_ACQ_REL);
+#endif
+   return previous;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::flush()
+{
+   if (_framebuffer == NULL)
+   {
+      return;
+   }
+
+   // Take the latest frame published, only this side clears the flag
+   if ((_fbBuffers > 1) && (_fbPending & LCD_FB_FRESH))
+   {
+      _fbFront = exchangePending(_fbFront) & ~LCD_FB_FRESH;
+      _fbCells = &_fbBase[_fbFront * _cols * _rows];
+   }
+
+   // Runs are streamed left to right, whatever the entry mode is. _displaymode
+   // belongs to the drawing side, only the mode sent changes meanwhile
+   // -----------------------------------------------------------
+   sendEntryMode(LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT);
+
+   for (uint8_t row = 0; (_controllers == 1) && (row < _rows); row++)
+   {
+      uint8_t *cells = &_fbCells[row * _cols];
+      uint8_t *shown = &_fbShown[row * _cols];
+      uint8_t col = 0;
+
+      while (col < _cols)
+      {
+         if (_fbSynced && (cells[col] == shown[col]))
+         {
+            col++;
+            continue;
+         }
+
+         // A run can't cross the split of a 16x1 panel, the address jumps there
+         uint8_t start = col;
+         while ((col < _cols) && !(_fbSynced && (cells[col] == shown[col])) &&
+                !((col == _splitCol) && (col != start)))
+         {
+            shown[col] = cells[col];
+            col++;
+         }
+
+         setDdramAddress(start, row);
+         transmitBuffer(&cells[start], col - start);
+      }
+   }
+
+   if (_controllers > 1)
+   {
+      flushInterleaved();
+   }
+   _fbSynced = true;
+
+   sendEntryMode(_displaymode);
+
+   // Leave a visible cursor where the application expects it
+   if ((_displaycontrol & (LCD_CURSOR_ON | LCD_BLINK_ON)) && (_fbCol < _cols))
+   {
+      setDdramAddress(_fbCol, _fbRow);
+      if (_cursorCtrl != _active)
+      {
+         command(LCD_DISPLAY_CONTROL | _displaycontrol);
+      }
+   }
+}
+
+// Each controller keeps its own address counter, so the two halves can be
+// written in turns: one controller executes while the other gets its byte.
+// Transports that are slower than the execution time anyway (I2C) send whole
+// runs per turn instead.
+template <class Transport>
+void BasicLiquidCrystal<Transport>::flushInterleaved()
+{
+   uint8_t chunk = this->interleaveBytes();
+   uint8_t row[2] = {0, 2};
+   uint8_t col[2] = {0, 0};
+   bool pending = true;
+
+   if (chunk == 0)
+   {
+      chunk = _cols;
+   }
+
+   while (pending)
+   {
+      pending = false;
+
+      for (uint8_t half = 0; half < 2; half++)
+      {
+         uint8_t lastRow = (2 * half + 2 < _rows) ? (2 * half + 2) : _rows;
+         uint8_t *cells;
+         uint8_t *shown;
+
+         // Next changed cell of this half
+         while (row[half] < lastRow)
+         {
+            cells = &_fbCells[row[half] * _cols];
+            shown = &_fbShown[row[half] * _cols];
+
+            if (col[half] >= _cols)
+            {
+               row[half]++;
+               col[half] = 0;
+            }
+            else if (_fbSynced && (cells[col[half]] == shown[col[half]]))
+            {
+               col[half]++;
+            }
+            else
+            {
+               break;
+            }
+         }
+         if (row[half] >= lastRow)
+         {
+            continue;
+         }
+         pending = true;
+
+         uint8_t start = col[half];
+         while ((col[half] < _cols) && ((col[half] - start) < chunk) &&
+                !(_fbSynced && (cells[col[half]] == shown[col[half]])))
+         {
+            shown[col[half]] = cells[col[half]];
+            col[half]++;
+         }
+
+         setDdramAddress(start, row[half]);
+         transmitBuffer(&cells[start], col[half] - start);
+      }
+   }
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setDdramAddress(uint8_t col, uint8_t row)
+{
+   uint8_t addr = ddramAddress(col, row);
+
+   activate(row);
+
+   // The address counter is already there after the previous write
+   if (addr == _ddramAddr)
+   {
+      return;
+   }
+
+   command(LCD_SET_DDRAM_ADDR | addr);
+   _ddramAddr = addr;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::sendDisplayControl()
+{
+   if (_sentControl != _displaycontrol)
+   {
+      command(LCD_DISPLAY_CONTROL | _displaycontrol);
+   }
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::sendEntryMode(uint8_t mode)
+{
+   if (_sentMode != mode)
+   {
+      command(LCD_ENTRY_MODE_SET | mode);
+   }
+}
+
+// Switching controller swaps the address counter copies
+template <class Transport>
+void BasicLiquidCrystal<Transport>::activate(uint8_t row)
+{
+   uint8_t controller = ((_controllers > 1) && (row >= 2)) ? LCD_CONTROLLER_2 : LCD_CONTROLLER_1;
+
+   if (controller != _active)
+   {
+      uint8_t addr = _ddramAddr;
+      _ddramAddr = _otherDdramAddr;
+      _otherDdramAddr = addr;
+      _active = controller;
+   }
+   _target = _active;
+}
+
+// Mirrors the LCD address counter: DDRAM is a ring of LCD_DDRAM_SIZE
+// characters, in 2 line mode line 1 is 0x00-0x27 and line 2 0x40-0x67.
+template <class Transport>
+void BasicLiquidCrystal<Transport>::advanceAddress(size_t size, bool left)
+{
+   if (_ddramAddr == LCD_NO_ADDR)
+   {
+      return;
+   }
+
+   bool twoLines = (_displayfunction & LCD_2_LINE);
+   uint8_t index = _ddramAddr;
+
+   if (twoLines)
+   {
+      if ((_ddramAddr & 0x3F) >= (LCD_DDRAM_SIZE / 2))
+      {
+         _ddramAddr = LCD_NO_ADDR; // outside both lines, unknown where it goes
+         return;
+      }
+      index = (_ddramAddr & 0x40) ? ((LCD_DDRAM_SIZE / 2) + (_ddramAddr & 0x3F)) : _ddramAddr;
+   }
+   else if (_ddramAddr >= LCD_DDRAM_SIZE)
+   {
+      _ddramAddr = LCD_NO_ADDR;
+      return;
+   }
+
+   size %= LCD_DDRAM_SIZE;
+   if (left)
+   {
+      index = (index + size) % LCD_DDRAM_SIZE;
+   }
+   else
+   {
+      index = (index + LCD_DDRAM_SIZE - size) % LCD_DDRAM_SIZE;
+   }
+
+   if (twoLines && (index >= (LCD_DDRAM_SIZE / 2)))
+   {
+      index = 0x40 + (index - (LCD_DDRAM_SIZE / 2));
+   }
+   _ddramAddr = index;
+}
+
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::display(lcd_mode_t mode)
+{
+	switch(mode) 
+   {
+		case DISPLAY_ON :
+			display();
+			break;
+		case DISPLAY_OFF:
+			noDisplay();
+			break;
+		case CURSOR_ON:
+			cursor();
+			break;
+		case CURSOR_OFF:
+			noCursor();
+			break;
+		case BLINK_ON:
+			blink();
+			break;
+		case BLINK_OFF:
+			noBlink();
+			break;
+		case SCROLL_LEFT:
+			scrollDisplayLeft();
+			break;
+		case SCROLL_RIGHT:
+			scrollDisplayRight();
+			break;
+		case LEFT_TO_RIGHT:
+			leftToRight();
+			break;
+		case RIGHT_TO_LEFT:
+			rightToLeft();
+			break;
+		case AUTOSCROLL_ON:
+			autoscroll();
+			break;
+		case AUTOSCROLL_OFF:
+			noAutoscroll();
+			break;
+		case BACKLIGHT_ON:
+			backlight();
+			break;
+		case BACKLIGHT_OFF:
+			noBacklight();
+			break;
+		}
+	}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::noDisplay()
+{
+   _displaycontrol &= ~LCD_DISPLAY_ON;
+   sendDisplayControl();
+}
+template <class Transport>
+void BasicLiquidCrystal<Transport>::display()
+{
+   _displaycontrol |= LCD_DISPLAY_ON;
+   sendDisplayControl();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::noCursor()
+{
+   _displaycontrol &= ~LCD_CURSOR_ON;
+   sendDisplayControl();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::cursor()
+{
+   _displaycontrol |= LCD_CURSOR_ON;
+   sendDisplayControl();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::noBlink()
+{
+   _displaycontrol &= ~LCD_BLINK_ON;
+   sendDisplayControl();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::blink()
+{
+   _displaycontrol |= LCD_BLINK_ON;
+   sendDisplayControl();
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::scrollDisplayLeft(void) //moveCursorLeft
+{
+   command(LCD_CURSOR_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_LEFT);
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::scrollDisplayRight(void)
+{
+   command(LCD_CURSOR_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_RIGHT);
+}
+template <class Transport>
+void BasicLiquidCrystal<Transport>::leftToRight(void)
+{
+   _displaymode |= LCD_ENTRY_LEFT;
+   sendEntryMode();
+}
+template <class Transport>
+void BasicLiquidCrystal<Transport>::rightToLeft(void)
+{
+   _displaymode &= ~LCD_ENTRY_LEFT;
+   sendEntryMode();
+}
+
+// This method moves the cursor one space to the right
+template <class Transport>
+void BasicLiquidCrystal<Transport>::moveCursorRight(void)
+{
+   command(LCD_CURSOR_SHIFT | LCD_CURSOR_MOVE | LCD_MOVE_RIGHT);
+
+   // Moves like a write in left to right mode
+   advanceAddress(1, true);
+}
+
+// This method moves the cursor one space to the left
+template <class Transport>
+void BasicLiquidCrystal<Transport>::moveCursorLeft(void)
+{
+   command(LCD_CURSOR_SHIFT | LCD_CURSOR_MOVE | LCD_MOVE_LEFT);
+
+   // Moves like a write in right to left mode
+   advanceAddress(1, false);
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::autoscroll(void)
+{
+   _displaymode |= LCD_ENTRY_SHIFT_INCREMENT;
+   sendEntryMode();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::noAutoscroll(void)
+{
+   _displaymode &= ~LCD_ENTRY_SHIFT_INCREMENT;
+   sendEntryMode();
+}
+
+// Write to CGRAM of new characters
+template <class Transport>
+void BasicLiquidCrystal<Transport>::createChar(uint8_t location, const uint8_t charmap[])
+{
+   writeCgram(location, charmap, 1);
+}
+
+#ifdef __AVR__
+template <class Transport>
+void BasicLiquidCrystal<Transport>::createChar(uint8_t location, const char *charmap)
+{
+   uint8_t rows[8];
+
+   // The bulk path reads RAM, copy the rows out of flash first
+   for (uint8_t i = 0; i < 8; i++)
+   {
+      rows[i] = pgm_read_byte_near(charmap++);
+   }
+   writeCgram(location, rows, 1);
+}
+#endif // __AVR__
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::createChars(uint8_t location, const uint8_t (*charmaps)[8], uint8_t count)
+{
+   // charmaps may be empty, and the CGRAM address would lose the DDRAM one
+   if (count == 0)
+   {
+      return;
+   }
+   writeCgram(location, charmaps[0], count);
+}
+
+// The address counter steps through CGRAM on its own, so consecutive
+// characters are just one longer run of rows.
+template <class Transport>
+void BasicLiquidCrystal<Transport>::writeCgram(uint8_t location, const uint8_t *rows, uint8_t count)
+{
+   location &= 0x7; // we only have 8 locations 0-7
+   if (count > (LCD_CGRAM_SLOTS - location))
+   {
+      count = LCD_CGRAM_SLOTS - location;
+   }
+
+   for (uint8_t i = 0; i < count; i++)
+   {
+      _slotGlyph[location + i] = LCD_NO_GLYPH;
+   }
+
+   // Both controllers of a dual controller display need the characters
+   command(LCD_SET_CGRAM_ADDR | (location << 3), 30);
+   _ddramAddr = LCD_NO_ADDR;
+   _otherDdramAddr = LCD_NO_ADDR;
+   _target = LCD_CONTROLLERS_ALL;
+   transmitBuffer(rows, 8 * count);
+   _target = _active;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setGlyphs(const uint8_t (*glyphs)[8], uint8_t count)
+{
+   _glyphs = glyphs;
+   _glyphCount = (glyphs != NULL) ? count : 0;
+   _glyphTick = 0;
+
+   memset(_slotGlyph, LCD_NO_GLYPH, sizeof(_slotGlyph));
+   memset(_slotUsed, 0, sizeof(_slotUsed));
+}
+
+template <class Transport>
+uint8_t BasicLiquidCrystal<Transport>::glyph(uint8_t id)
+{
+   if (id >= _glyphCount)
+   {
+      return ' ';
+   }
+
+   // Keep every _slotUsed at or below _glyphTick: before the counter wraps
+   // take half its range off, slots unused for that long all count as oldest
+   if (_glyphTick == 0xFFFF)
+   {
+      _glyphTick -= 0x8000;
+      for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+      {
+         _slotUsed[slot] = (_slotUsed[slot] > 0x8000) ? (_slotUsed[slot] - 0x8000) : 0;
+      }
+   }
+   _glyphTick++;
+
+   for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+   {
+      if (_slotGlyph[slot] == id)
+      {
+         _slotUsed[slot] = _glyphTick;
+         return slot;
+      }
+   }
+
+   // Miss: evict the least recently used slot, sparing the ones on screen
+   // unless every slot is. Free slots are the oldest of all.
+   uint8_t visible = visibleSlots();
+   uint8_t victim = 0;
+   uint16_t victimAge = 0;
+   bool victimVisible = true;
+
+   for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+   {
+      bool slotVisible = (visible & (1 << slot)) != 0;
+      uint16_t age = (_slotGlyph[slot] == LCD_NO_GLYPH) ? 0xFFFF : (_glyphTick - _slotUsed[slot]);
+
+      if ((victimVisible && !slotVisible) ||
+          ((victimVisible == slotVisible) && (age > victimAge)))
+      {
+         victim = slot;
+         victimAge = age;
+         victimVisible = slotVisible;
+      }
+   }
+
+   // The upload leaves the address counter in CGRAM, put it back where the
+   // next write expects it
+   uint8_t addr = _ddramAddr;
+
+   createChar(victim, _glyphs[id]);
+   if (addr != LCD_NO_ADDR)
+   {
+      command(LCD_SET_DDRAM_ADDR | addr);
+      _ddramAddr = addr;
+   }
+   _slotGlyph[victim] = id;
+   _slotUsed[victim] = _glyphTick;
+   return victim;
+}
+
+// Every cell buffer and, once flushed, the cells shown count.
+// Codes 8-15 show the same CGRAM characters as 0-7.
+template <class Transport>
+uint8_t BasicLiquidCrystal<Transport>::visibleSlots()
+{
+   uint8_t visible = 0;
+
+   if (_framebuffer != NULL)
+   {
+      uint16_t cells = (_fbBuffers + (_fbSynced ? 1 : 0)) * _cols * _rows;
+
+      for (uint16_t i = 0; i < cells; i++)
+      {
+         if (_fbBase[i] < (2 * LCD_CGRAM_SLOTS))
+         {
+            visible |= 1 << (_fbBase[i] & (LCD_CGRAM_SLOTS - 1));
+         }
+      }
+   }
+   return visible;
+}
+
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::backlight(void)
+{
+   switch (_polarity)
+   {
+   case POSITIVE:
+      _backlightValue = LCD_BACKLIGHT_ON;
+      break;
+
+   case NEGATIVE:
+      _backlightValue = ~LCD_BACKLIGHT_ON;
+      break;
+   default:
+      return;
+   }
+
+   this->setBacklight(LCD_BACKLIGHT);
+}
+
+//
+// Switch off the backlight
+template <class Transport>
+void BasicLiquidCrystal<Transport>::noBacklight(void)
+{
+   switch (_polarity)
+   {
+   case POSITIVE:
+      _backlightValue = LCD_BACKLIGHT_OFF;
+      break;
+
+   case NEGATIVE:
+      _backlightValue = ~LCD_BACKLIGHT_OFF;
+      break;
+   default:
+      return;
+   }
+
+   this->setBacklight(LCD_NOBACKLIGHT);
+}
+
+//
+// Switch fully on the LCD (backlight and LCD)
+template <class Transport>
+void BasicLiquidCrystal<Transport>::on(void)
+{
+   display();
+   backlight();
+}
+
+//
+// Switch fully off the LCD (backlight and LCD)
+template <class Transport>
+void BasicLiquidCrystal<Transport>::off(void)
+{
+   noBacklight();
+   noDisplay();
+}
+
+//& General LCD commands - generic methods used by the rest of the commands
+//& ---------------------------------------------------------------------------
+
+// On dual controller displays address and cursor moves go to the active
+// controller and everything else to both, but the cursor and blink only
+// show on the active one.
+template <class Transport>
+void BasicLiquidCrystal<Transport>::command(uint8_t value, uint16_t execTime)
+{
+   // What the controller holds, for the setters to skip no-op commands
+   if ((value & 0xF8) == LCD_DISPLAY_CONTROL)
+   {
+      _sentControl = value & ~LCD_DISPLAY_CONTROL;
+   }
+   else if ((value & 0xFC) == LCD_ENTRY_MODE_SET)
+   {
+      _sentMode = value & ~LCD_ENTRY_MODE_SET;
+   }
+
+   if (_controllers == 1)
+   {
+      transmit(value, COMMAND, execTime);
+      return;
+   }
+
+   if ((value & LCD_SET_DDRAM_ADDR) ||
+       (((value & 0xF0) == LCD_CURSOR_SHIFT) && !(value & LCD_DISPLAY_MOVE)))
+   {
+      _target = _active;
+   }
+   else if ((value & 0xF8) == LCD_DISPLAY_CONTROL)
+   {
+      _target = LCD_CONTROLLERS_ALL ^ _active;
+      transmit(value & ~(LCD_CURSOR_ON | LCD_BLINK_ON), COMMAND, 0);
+      _target = _active;
+      _cursorCtrl = _active;
+   }
+   else
+   {
+      _target = LCD_CONTROLLERS_ALL;
+   }
+
+   transmit(value, COMMAND, execTime);
+   _target = _active;
+}
+
+// Either send now and block for the execution time, or queue for poll()
+template <class Transport>
+void BasicLiquidCrystal<Transport>::transmit(uint8_t value, uint8_t mode, uint16_t execTime)
+{
+   if (mode == LCD_DATA)
+   {
+      advanceAddress(1, _sentMode & LCD_ENTRY_LEFT);
+   }
+
+   if (!_async)
+   {
+      if (_controllers > 1)
+      {
+         this->selectController(_target);
+      }
+      this->send(value, mode);
+      LCD_STAT(countSend(mode, execTime));
+      if (execTime)
+      {
+         this->drainTransport(); // the execution time runs from the strobe
+      }
+      if (_busyPolling)
+      {
+         _issuedAt = micros();
+         _execTime = execTime;
+         while (!ready())
+         {
+         }
+      }
+      else if (execTime)
+      {
+         waitMicroseconds(execTime);
+      }
+      return;
+   }
+
+   uint8_t next = (_qHead + 1) % LCD_QUEUE_SIZE;
+   while (next == _qTail)
+   {
+      poll(); // queue full, fall back to blocking until a slot frees up
+   }
+
+   _queue[_qHead].value = value;
+   _queue[_qHead].mode = mode | (_target << 4);
+   _queue[_qHead].execTime = execTime;
+   _qHead = next;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::transmitBuffer(const uint8_t *buffer, size_t size)
+{
+   if (!_async)
+   {
+      if (_controllers > 1)
+      {
+         this->selectController(_target);
+      }
+      this->sendBuffer(buffer, size);
+      advanceAddress(size, _sentMode & LCD_ENTRY_LEFT);
+      LCD_STAT(_stats.sends++);
+      LCD_STAT(_stats.dataBytes += size);
+      return;
+   }
+
+   for (size_t i = 0; i < size; i++)
+   {
+      transmit(buffer[i], LCD_DATA, 0);
+   }
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::setAsync(bool async)
+{
+   if (_async && !async)
+   {
+      // Drain what is queued so that blocking calls start from an idle LCD
+      while (poll() || !ready())
+      {
+      }
+   }
+   else if (!_async && async)
+   {
+      _issuedAt = micros();
+      _execTime = 0;
+   }
+   _async = async;
+}
+
+template <class Transport>
+bool BasicLiquidCrystal<Transport>::poll(uint8_t maxOps)
+{
+   // Issue every queued operation whose predecessor has finished executing
+   while ((_qHead != _qTail) && (maxOps-- > 0) && ready())
+   {
+      lcd_op_t *op = &_queue[_qTail];
+
+      if (_controllers > 1)
+      {
+         this->selectController(op->mode >> 4);
+      }
+      this->send(op->value, op->mode & 0x0F);
+      LCD_STAT(countSend(op->mode & 0x0F, op->execTime));
+      if (op->execTime)
+      {
+         this->drainTransport();
+      }
+      _issuedAt = micros();
+      _execTime = op->execTime;
+      _qTail = (_qTail + 1) % LCD_QUEUE_SIZE;
+   }
+   return (_qHead != _qTail);
+}
+
+// The worst case execution time always applies, the busy flag can only
+// shorten it. A driver that fails to read it just falls back to the delays.
+template <class Transport>
+bool BasicLiquidCrystal<Transport>::ready()
+{
+   if ((micros() - _issuedAt) >= _execTime)
+   {
+      return true;
+   }
+   return (_busyPolling && !(this->readStatus() & LCD_BUSY_FLAG));
+}
+
+template <class Transport>
+bool BasicLiquidCrystal<Transport>::setBusyFlagPolling(bool enable)
+{
+   if (enable && !this->canReadStatus())
+   {
+      return false;
+   }
+   _busyPolling = enable;
+   this->setStatusPolling(enable);
+   return true;
+}
+
+#if (ARDUINO < 100)
+template <class Transport>
+void BasicLiquidCrystal<Transport>::write(uint8_t value)
+{
+   if (_framebuffer != NULL)
+   {
+      writeFramebuffer(&value, 1);
+      return;
+   }
+   transmit(value, LCD_DATA, 0);
+}
+#else
+template <class Transport>
+size_t BasicLiquidCrystal<Transport>::write(uint8_t value)
+{
+   if (_framebuffer != NULL)
+   {
+      writeFramebuffer(&value, 1);
+      return 1;
+   }
+   transmit(value, LCD_DATA, 0);
+   return 1; // assume OK
+}
+#endif
+
+#if (ARDUINO < 100)
+template <class Transport>
+void BasicLiquidCrystal<Transport>::write(const uint8_t *buffer, size_t size)
+{
+   if (_framebuffer != NULL)
+   {
+      writeFramebuffer(buffer, size);
+      return;
+   }
+   transmitBuffer(buffer, size);
+}
+#else
+template <class Transport>
+size_t BasicLiquidCrystal<Transport>::write(const uint8_t *buffer, size_t size)
+{
+   if (_framebuffer != NULL)
+   {
+      writeFramebuffer(buffer, size);
+      return size;
+   }
+   transmitBuffer(buffer, size);
+   return size; // assume OK
+}
+#endif
+
+// Characters falling outside the display are dropped, like on a real LCD
+// where they would land in DDRAM that is not shown.
+template <class Transport>
+void BasicLiquidCrystal<Transport>::writeFramebuffer(const uint8_t *buffer, size_t size)
+{
+   for (size_t i = 0; i < size; i++)
+   {
+      if (_fbCol < _cols)
+      {
+         _framebuffer[_fbRow * _cols + _fbCol] = buffer[i];
+      }
+
+      if (_displaymode & LCD_ENTRY_LEFT)
+      {
+         _fbCol++;
+      }
+      else
+      {
+         _fbCol--;
+      }
+   }
+}
+
+#ifdef LCD_STATS
+template <class Transport>
+lcd_stats_t BasicLiquidCrystal<Transport>::getStats()
+{
+   lcd_stats_t stats = _stats;
+   this->transportStats(&stats);
+   return stats;
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::resetStats()
+{
+   memset(&_stats, 0, sizeof(_stats));
+   this->resetTransportStats();
+}
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::countSend(uint8_t mode, uint16_t execTime)
+{
+   _stats.sends++;
+   if (mode == LCD_DATA)
+   {
+      _stats.dataBytes++;
+   }
+   else
+   {
+      _stats.commands++;
+   }
+   _stats.waitMicros += execTime;
+}
+#endif
+
+template <class Transport>
+void BasicLiquidCrystal<Transport>::waitMicroseconds(uint32_t cmdDelay)
+{
+#ifdef RTOS
+   task_wait(cmdDelay);
+#else
+   // delayMicroseconds() is only accurate up to 16383us
+   if (cmdDelay > 16383)
+   {
+      delay(cmdDelay / 1000);
+      cmdDelay %= 1000;
+   }
+   delayMicroseconds(cmdDelay);
+#endif
+}
+
+#endif // _BasicLiquidCrystal_H_
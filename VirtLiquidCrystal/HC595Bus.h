@@ -0,0 +1,299 @@
+/**
+ * @file HC595Bus.h
+ * @brief Transport driving an HD44780 LCD in 4 bit mode through a 74HC595 shift register on hardware SPI.
+ *
+ * Header only so that BasicLiquidCrystal<HC595Bus> resolves the transport at
+ * compile time. LiquidCrystal_SPI is the virtual adapter over it.
+ *
+ * MOSI goes to the 74HC595 serial input, SCK to its shift clock and a spare pin
+ * to its latch (RCLK). Each port update is one byte shifted out and a latch
+ * pulse, so an enable strobe takes a few microseconds instead of the hundreds
+ * of an I2C frame. The LCD execution time then dominates: like ParallelBus,
+ * each strobe waits for what is left of it on the controller it goes to.
+ * R/W is tied to ground, the busy flag can't be read.
+ */
+
+#ifndef _HC595Bus_H_
+#define _HC595Bus_H_
+
+#include <SPI.h>
+
+#include "BasicLiquidCrystal.h"
+
+// Default wiring, the one of the common SPI/I2C backpacks
+#define HC595_LCD_RS 1 // Register select output
+#define HC595_LCD_EN 2 // Enable output
+#define HC595_LCD_D4 6
+#define HC595_LCD_D5 5
+#define HC595_LCD_D6 4
+#define HC595_LCD_D7 3
+
+/** @brief Default SPI clock, the 74HC595 takes well over 20MHz at 5V */
+#define HC595_SPI_CLOCK 8000000
+
+/** @brief Microseconds the HD44780 needs after most instructions */
+#define HC595_EXEC_TIME 37
+
+class HC595Bus
+{
+public:
+  /** @brief Set the latch pin and the register outputs (Q0-Q7) the LCD is wired to */
+  void config(uint8_t latchPin, uint8_t En = HC595_LCD_EN, uint8_t Rs = HC595_LCD_RS,
+              uint8_t d4 = HC595_LCD_D4, uint8_t d5 = HC595_LCD_D5, uint8_t d6 = HC595_LCD_D6, uint8_t d7 = HC595_LCD_D7,
+              uint8_t backlighPin = 0, t_backlighPol pol = POSITIVE);
+
+  void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE);
+  void setBacklight(uint8_t value);
+
+  /** @brief Register output of the second enable line of 40x4 displays (rows 2-3), call before begin() */
+  void setEnable2Pin(uint8_t En2);
+
+  /** @brief SPI clock in Hz, default HC595_SPI_CLOCK */
+  void setClock(uint32_t clock) { _clock = clock; };
+
+  //& Transport interface used by BasicLiquidCrystal --------------------------------------------------------------------------
+
+  uint8_t beginTransport();
+  uint8_t bitMode() { return LCD_4BIT_MODE; };
+  void send(uint8_t value, uint8_t mode);
+  void sendBuffer(const uint8_t *buffer, size_t size);
+  bool canReadStatus() { return false; };
+  uint8_t readStatus() { return LCD_BUSY_FLAG; };
+  void setStatusPolling(bool){};
+  uint8_t controllers() { return (_en2Mask != 0) ? 2 : 1; };
+  void selectController(uint8_t mask);
+  uint8_t interleaveBytes() { return 1; };
+  void drainTransport(){};
+
+#ifdef LCD_STATS
+  void transportStats(lcd_stats_t *){};
+  void resetTransportStats(){};
+#endif
+
+private:
+  void write4bits(uint8_t value, uint8_t rsMask);
+  void shiftOut(uint8_t frame);
+  void waitReady();
+  void strobed();
+
+  uint8_t _latchPin;
+  uint32_t _clock;      // SPI clock
+  uint8_t _enMask;      // Enable output mask
+  uint8_t _en2Mask;     // Second controller enable output mask, 0 if none
+  uint8_t _selectedEn;  // Enable masks strobed
+  uint8_t _rsMask;      // Register select output mask
+  uint8_t _data_pins[4]; // LCD data lines, output masks
+
+  uint8_t _backlightPinMask; // Backlight output mask
+  uint8_t _backlightStsMask; // Backlight status mask
+  t_backlighPol _backlightPol;
+
+  uint32_t _strobeAt[2]; // micros() of the last strobe of each controller
+
+#ifdef FAST_MODE
+  volatile uint8_t *_latchPort; // Output register of the latch pin, resolved in beginTransport()
+  uint8_t _latchMask;
+#endif
+};
+
+inline void HC595Bus::config(uint8_t latchPin, uint8_t En, uint8_t Rs,
+                             uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                             uint8_t backlighPin, t_backlighPol pol)
+{
+  _latchPin = latchPin;
+  _clock = HC595_SPI_CLOCK;
+  _enMask = (1 << En);
+  _en2Mask = 0;
+  _selectedEn = _enMask;
+  _rsMask = (1 << Rs);
+
+  _data_pins[0] = (1 << d4);
+  _data_pins[1] = (1 << d5);
+  _data_pins[2] = (1 << d6);
+  _data_pins[3] = (1 << d7);
+
+  if (backlighPin)
+  {
+    setBacklightPin(backlighPin, pol);
+  }
+  else
+  {
+    _backlightPinMask = 0;
+    _backlightStsMask = LCD_NOBACKLIGHT;
+    _backlightPol = pol;
+  }
+}
+
+inline void HC595Bus::setBacklightPin(uint8_t pin, t_backlighPol pol)
+{
+  _backlightPinMask = (1 << pin);
+  _backlightPol = pol;
+  _backlightStsMask = (pol == NEGATIVE) ? _backlightPinMask : LCD_NOBACKLIGHT; // off until begin()
+}
+
+// Takes effect with the next port update, which is sent right away
+inline void HC595Bus::setBacklight(uint8_t value)
+{
+  if (_backlightPinMask != 0x0)
+  {
+    if (((_backlightPol == POSITIVE) && (value > 0)) ||
+        ((_backlightPol == NEGATIVE) && (value == 0)))
+    {
+      _backlightStsMask = _backlightPinMask;
+    }
+    else
+    {
+      _backlightStsMask = LCD_NOBACKLIGHT;
+    }
+    SPI.beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+    shiftOut(_backlightStsMask);
+    SPI.endTransaction();
+  }
+}
+
+inline void HC595Bus::setEnable2Pin(uint8_t En2)
+{
+  _en2Mask = (1 << En2);
+}
+
+inline void HC595Bus::selectController(uint8_t mask)
+{
+  _selectedEn = ((mask & LCD_CONTROLLER_1) ? _enMask : 0) | ((mask & LCD_CONTROLLER_2) ? _en2Mask : 0);
+}
+
+inline uint8_t HC595Bus::beginTransport()
+{
+  pinMode(_latchPin, OUTPUT);
+  digitalWrite(_latchPin, LOW);
+  SPI.begin();
+
+#ifdef FAST_MODE
+  _latchPort = portOutputRegister(digitalPinToPort(_latchPin));
+  _latchMask = digitalPinToBitMask(_latchPin);
+#endif
+
+  _selectedEn = _enMask;
+  _strobeAt[0] = micros() - HC595_EXEC_TIME;
+  _strobeAt[1] = _strobeAt[0];
+
+  SPI.beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+  shiftOut(_backlightStsMask); // all LCD lines low
+  SPI.endTransaction();
+
+  return true; // nothing answers on the bus, the LCD is assumed there
+}
+
+/************ low level data pushing commands **********/
+
+// RS is latched with the data of the first nibble while EN is still low, so
+// it is stable before the enable rising edge (address setup time).
+// The wait for the LCD is outside the SPI transaction, other devices on the
+// bus can use it meanwhile; the 74HC595 outputs only change on a latch pulse.
+inline void HC595Bus::send(uint8_t value, uint8_t mode)
+{
+  uint8_t rsMask = (mode == LCD_DATA) ? _rsMask : 0;
+
+  waitReady();
+  SPI.beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+  shiftOut(rsMask | _backlightStsMask);
+
+  if (mode == FOUR_BITS)
+  {
+    write4bits((value & 0x0F), rsMask);
+  }
+  else
+  {
+    write4bits((value >> 4), rsMask);
+    write4bits((value & 0x0F), rsMask);
+  }
+  strobed();
+
+  SPI.endTransaction();
+}
+
+// Stream a run of data bytes, RS is set once for the whole run. One SPI
+// transaction per byte, the bus is free while the LCD executes the last one.
+inline void HC595Bus::sendBuffer(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    waitReady();
+    SPI.beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+    if (i == 0)
+    {
+      shiftOut(_rsMask | _backlightStsMask);
+    }
+    write4bits((buffer[i] >> 4), _rsMask);
+    write4bits((buffer[i] & 0x0F), _rsMask);
+    strobed();
+    SPI.endTransaction();
+  }
+}
+
+// One enable strobe of a nibble: EN high with the data, then EN low
+inline void HC595Bus::write4bits(uint8_t value, uint8_t rsMask)
+{
+  uint8_t frame = rsMask | _backlightStsMask;
+
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    if (value & (1 << i))
+    {
+      frame |= _data_pins[i];
+    }
+  }
+
+  shiftOut(frame | _selectedEn); // En high, a whole SPI byte outlasts the 450ns pulse width
+  shiftOut(frame);               // En low, the LCD latches the data
+}
+
+// Shift a byte in and copy it to the outputs on the latch rising edge
+inline void HC595Bus::shiftOut(uint8_t frame)
+{
+  SPI.transfer(frame);
+#ifdef FAST_MODE
+  *_latchPort |= _latchMask;
+  *_latchPort &= ~_latchMask;
+#else
+  digitalWrite(_latchPin, HIGH);
+  digitalWrite(_latchPin, LOW);
+#endif
+}
+
+// Wait until every selected controller is done with its last instruction
+inline void HC595Bus::waitReady()
+{
+  uint32_t now = micros();
+  uint32_t wait = 0;
+
+  for (uint8_t c = 0; c < 2; c++)
+  {
+    uint32_t elapsed = now - _strobeAt[c];
+    uint8_t mask = (c == 0) ? _enMask : _en2Mask;
+
+    if ((_selectedEn & mask) && (elapsed < HC595_EXEC_TIME) && (HC595_EXEC_TIME - elapsed > wait))
+    {
+      wait = HC595_EXEC_TIME - elapsed;
+    }
+  }
+  if (wait)
+  {
+    delayMicroseconds(wait);
+  }
+}
+
+inline void HC595Bus::strobed()
+{
+  uint32_t now = micros();
+
+  if (_selectedEn & _enMask)
+  {
+    _strobeAt[0] = now;
+  }
+  if (_selectedEn & _en2Mask)
+  {
+    _strobeAt[1] = now;
+  }
+}
+
+#endif // _HC595Bus_H_
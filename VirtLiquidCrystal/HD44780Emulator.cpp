@@ -0,0 +1,391 @@
+#include <string.h>
+#include <inttypes.h>
+
+#if (ARDUINO < 100)
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#include "HD44780Emulator.h"
+
+// DDRAM address bit selecting the second line in 2 line mode
+#define HD44780_LINE_2 0x40
+
+// ---------------------------------------------------------------------------
+// HD44780 controller model
+// ---------------------------------------------------------------------------
+HD44780::HD44780()
+{
+   reset();
+}
+
+void HD44780::reset()
+{
+   memset(_ddram, ' ', sizeof(_ddram));
+   memset(_cgram, 0, sizeof(_cgram));
+
+   // Internal reset circuit state, see the datasheet "Initializing by Internal Reset Circuit"
+   _ac = 0;
+   _cgSelected = false;
+   _entryMode = LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT;
+   _displayControl = LCD_DISPLAY_OFF | LCD_CURSOR_OFF | LCD_BLINK_OFF;
+   _functionSet = LCD_8BIT_MODE | LCD_1_LINE | LCD_5x8DOTS;
+   _shift = 0;
+
+   _lowNibble = false;
+   _highNibble = 0;
+   _nibbleOverrun = false;
+   _readLatch = 0;
+
+   _issuedAt = micros();
+   _execTime = HD44780_POWER_ON_RESET;
+   _executed = 0;
+   _overruns = 0;
+}
+
+void HD44780::strobe(uint8_t data, bool rs)
+{
+   if (_functionSet & LCD_8BIT_MODE)
+   {
+      execute(data, rs);
+      return;
+   }
+
+   // 4 bit interface, high nibble first on DB7..DB4. The controller must
+   // already be ready for it, the byte is lost otherwise.
+   if (!_lowNibble)
+   {
+      _highNibble = data & 0xF0;
+      _lowNibble = true;
+      _nibbleOverrun = busy();
+      return;
+   }
+   _lowNibble = false;
+   if (_nibbleOverrun)
+   {
+      _overruns++;
+      return;
+   }
+   execute(_highNibble | (data >> 4), rs);
+}
+
+uint8_t HD44780::read(bool rs)
+{
+   if (!(_functionSet & LCD_8BIT_MODE) && _lowNibble)
+   {
+      _lowNibble = false;
+      return (_readLatch << 4);
+   }
+
+   if (rs)
+   {
+      _readLatch = readRam();
+   }
+   else
+   {
+      _readLatch = (busy() ? LCD_BUSY_FLAG : 0) | _ac;
+   }
+
+   if (_functionSet & LCD_8BIT_MODE)
+   {
+      return _readLatch;
+   }
+   _lowNibble = true;
+   return (_readLatch & 0xF0);
+}
+
+bool HD44780::busy()
+{
+   return ((micros() - _issuedAt) < _execTime);
+}
+
+// The display shift scrolls each line within itself
+uint8_t HD44780::charAt(uint8_t addr)
+{
+   uint8_t length = lineLength();
+   uint8_t index = ddramIndex(addr);
+
+   return _ddram[(index - (index % length)) + ((index % length) + _shift) % length];
+}
+
+// ---------------------------------------------------------------------------
+// Instruction decoding
+// ---------------------------------------------------------------------------
+void HD44780::execute(uint8_t value, bool rs)
+{
+   uint32_t now = micros();
+
+   // A real controller ignores or garbles what it gets while busy, drop it
+   if ((now - _issuedAt) < _execTime)
+   {
+      _overruns++;
+      return;
+   }
+
+   _issuedAt = now;
+   _execTime = HD44780_EXEC_DEFAULT;
+   _executed++;
+
+   if (rs)
+   {
+      writeRam(value);
+   }
+   else
+   {
+      instruction(value);
+   }
+}
+
+void HD44780::instruction(uint8_t value)
+{
+   if (value & LCD_SET_DDRAM_ADDR)
+   {
+      _ac = value & 0x7F;
+      _cgSelected = false;
+   }
+   else if (value & LCD_SET_CGRAM_ADDR)
+   {
+      _ac = value & 0x3F;
+      _cgSelected = true;
+   }
+   else if (value & LCD_FUNCTION_SET)
+   {
+      _functionSet = value & (LCD_8BIT_MODE | LCD_2_LINE | LCD_5x10DOTS);
+      _lowNibble = false;
+   }
+   else if (value & LCD_CURSOR_SHIFT)
+   {
+      if (value & LCD_DISPLAY_MOVE)
+      {
+         shiftDisplay(!(value & LCD_MOVE_RIGHT));
+      }
+      else
+      {
+         _cgSelected = false;
+         stepAddress(value & LCD_MOVE_RIGHT);
+      }
+   }
+   else if (value & LCD_DISPLAY_CONTROL)
+   {
+      _displayControl = value & (LCD_DISPLAY_ON | LCD_CURSOR_ON | LCD_BLINK_ON);
+   }
+   else if (value & LCD_ENTRY_MODE_SET)
+   {
+      _entryMode = value & (LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_INCREMENT);
+   }
+   else if (value & LCD_RETURN_HOME)
+   {
+      _ac = 0;
+      _cgSelected = false;
+      _shift = 0;
+      _execTime = HD44780_EXEC_HOME;
+   }
+   else if (value & LCD_CLEAR_DISPLAY)
+   {
+      memset(_ddram, ' ', sizeof(_ddram));
+      _ac = 0;
+      _cgSelected = false;
+      _shift = 0;
+      _entryMode |= LCD_ENTRY_LEFT; // clear sets I/D, S is left alone
+      _execTime = HD44780_EXEC_CLEAR;
+   }
+}
+
+void HD44780::writeRam(uint8_t value)
+{
+   if (_cgSelected)
+   {
+      _cgram[_ac & 0x3F] = value;
+   }
+   else
+   {
+      _ddram[ddramIndex(_ac)] = value;
+   }
+
+   stepAddress(_entryMode & LCD_ENTRY_LEFT);
+
+   // Shift on write moves the display along with the cursor
+   if (!_cgSelected && (_entryMode & LCD_ENTRY_SHIFT_INCREMENT))
+   {
+      shiftDisplay(_entryMode & LCD_ENTRY_LEFT);
+   }
+}
+
+uint8_t HD44780::readRam()
+{
+   uint8_t value;
+
+   if (_cgSelected)
+   {
+      value = _cgram[_ac & 0x3F];
+   }
+   else
+   {
+      value = _ddram[ddramIndex(_ac)];
+   }
+
+   stepAddress(_entryMode & LCD_ENTRY_LEFT);
+   return value;
+}
+
+// The DDRAM address counter wraps from the end of line 1 to line 2 and back
+void HD44780::stepAddress(bool increment)
+{
+   if (_cgSelected)
+   {
+      _ac = (_ac + (increment ? 1 : -1)) & 0x3F;
+      return;
+   }
+
+   uint8_t length = lineLength();
+
+   if (!(_functionSet & LCD_2_LINE))
+   {
+      _ac = increment ? ((_ac + 1) % length) : ((_ac + length - 1) % length);
+      return;
+   }
+
+   uint8_t pos = _ac & ~HD44780_LINE_2;
+   uint8_t line = _ac & HD44780_LINE_2;
+
+   if (increment)
+   {
+      if (++pos >= length)
+      {
+         pos = 0;
+         line ^= HD44780_LINE_2;
+      }
+   }
+   else
+   {
+      if (pos-- == 0)
+      {
+         pos = length - 1;
+         line ^= HD44780_LINE_2;
+      }
+   }
+   _ac = line | pos;
+}
+
+void HD44780::shiftDisplay(bool left)
+{
+   uint8_t length = lineLength();
+   _shift = left ? ((_shift + 1) % length) : ((_shift + length - 1) % length);
+}
+
+uint8_t HD44780::ddramIndex(uint8_t addr)
+{
+   uint8_t length = lineLength();
+
+   if (!(_functionSet & LCD_2_LINE))
+   {
+      return (addr % length);
+   }
+   return ((addr & HD44780_LINE_2) ? length : 0) + ((addr & ~HD44780_LINE_2) % length);
+}
+
+uint8_t HD44780::lineLength()
+{
+   return (_functionSet & LCD_2_LINE) ? (HD44780_DDRAM_SIZE / 2) : HD44780_DDRAM_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+// HD44780Emulator driver
+// ---------------------------------------------------------------------------
+HD44780Emulator::HD44780Emulator(uint8_t cols, uint8_t rows, uint8_t charsize, uint8_t bitmode)
+{
+   _bitmode = bitmode;
+   _backlight = 0;
+   _busTime = HD44780_EXEC_DEFAULT;
+   _selected = LCD_CONTROLLER_1;
+
+   init(cols, rows, charsize);
+}
+
+// There is no backlight pin, only the polarity matters
+void HD44780Emulator::setBacklightPin(uint8_t, t_backlighPol pol)
+{
+   _polarity = pol;
+}
+
+void HD44780Emulator::setBacklight(uint8_t value)
+{
+   _backlight = value;
+}
+
+uint8_t HD44780Emulator::charAt(uint8_t col, uint8_t row)
+{
+   return _lcd[(row >= 2) ? controllers() - 1 : 0].charAt(panelAddress(col, row));
+}
+
+void HD44780Emulator::readRow(uint8_t row, char *buffer)
+{
+   for (uint8_t col = 0; col < _cols; col++)
+   {
+      buffer[col] = charAt(col, row);
+   }
+   buffer[_cols] = '\0';
+}
+
+// Independent of the driver's geometry table on purpose
+uint8_t HD44780Emulator::panelAddress(uint8_t col, uint8_t row)
+{
+   if (controllers() > 1)
+   {
+      return ((row & 0x01) ? 0x40 : 0x00) + col; // two 2 line controllers
+   }
+   if ((_rows == 1) && (_cols == 16))
+   {
+      return (col < 8) ? col : (0x40 + col - 8);
+   }
+   return ((row & 0x01) ? 0x40 : 0x00) + ((row & 0x02) ? _cols : 0) + col;
+}
+
+// begin() powers the display up
+uint8_t HD44780Emulator::beginTransport()
+{
+   _lcd[0].reset();
+   _lcd[1].reset();
+   _selected = LCD_CONTROLLER_1;
+   return true;
+}
+
+void HD44780Emulator::send(uint8_t value, uint8_t mode)
+{
+   bool rs = (mode == LCD_DATA);
+
+   for (uint8_t c = 0; c < 2; c++)
+   {
+      if (!(_selected & (1 << c)))
+      {
+         continue;
+      }
+
+      if (mode == FOUR_BITS)
+      {
+         _lcd[c].strobe(value << 4, false);
+      }
+      else if (_bitmode == LCD_4BIT_MODE)
+      {
+         _lcd[c].strobe(value & 0xF0, rs);
+         _lcd[c].strobe(value << 4, rs);
+      }
+      else
+      {
+         _lcd[c].strobe(value, rs);
+      }
+   }
+
+   delayMicroseconds(_busTime);
+}
+
+uint8_t HD44780Emulator::readStatus()
+{
+   if (_bitmode == LCD_4BIT_MODE)
+   {
+      uint8_t status = _lcd[0].read(false);
+      return (status | (_lcd[0].read(false) >> 4));
+   }
+   return _lcd[0].read(false);
+}
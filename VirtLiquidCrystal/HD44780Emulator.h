@@ -0,0 +1,166 @@
+/**
+ * @file HD44780Emulator.h
+ * @brief Software model of an HD44780 controller and an LCD driver rendering into it.
+ *
+ * HD44780 models what the controller does with the bus lines it latches on each
+ * enable strobe: DDRAM, CGRAM, the address counter, entry mode, display shift,
+ * 4 bit nibble sequencing and the execution time of every instruction.
+ * HD44780Emulator is a VirtLiquidCrystal driving such a model instead of pins, so
+ * the whole display path can be exercised and timed on a host (see extras/host).
+ */
+
+#ifndef _HD44780Emulator_H_
+#define _HD44780Emulator_H_
+
+#include "VirtLiquidCrystal.h"
+
+/** @brief Size of the display data RAM, 80 characters */
+#define HD44780_DDRAM_SIZE 0x50
+
+/** @brief Size of the character generator RAM, 8 characters of 8 rows */
+#define HD44780_CGRAM_SIZE 0x40
+
+/** @brief Instruction execution times in microseconds (fosc = 270kHz) */
+#define HD44780_EXEC_CLEAR 1520
+#define HD44780_EXEC_HOME 1520
+#define HD44780_EXEC_DEFAULT 37
+
+/** @brief Time the controller stays busy after power on, internal reset */
+#define HD44780_POWER_ON_RESET 10000
+
+/** @brief HD44780 controller state, fed one enable strobe at a time */
+class HD44780
+{
+public:
+  HD44780();
+
+  /** @brief Power on reset: 8 bit interface, 1 line, display off, busy for a while */
+  void reset();
+
+  /** @brief Latch the data lines on the enable falling edge
+   *
+   *  @param data DB7..DB0, only DB7..DB4 are used with a 4 bit interface
+   *  @param rs false for an instruction, true for data
+   */
+  void strobe(uint8_t data, bool rs);
+
+  /** @brief Enable strobe with R/W high, returns what the controller drives
+   *
+   *  @param rs false for the busy flag and address counter, true for RAM data
+   *  @return DB7..DB0, the current nibble in DB7..DB4 with a 4 bit interface
+   */
+  uint8_t read(bool rs);
+
+  /** @brief Check if an instruction is still executing */
+  bool busy();
+
+  /** @brief Character shown where DDRAM address addr is without display shift */
+  uint8_t charAt(uint8_t addr);
+
+  uint8_t ddram(uint8_t addr) { return _ddram[addr % HD44780_DDRAM_SIZE]; };
+  uint8_t cgram(uint8_t addr) { return _cgram[addr % HD44780_CGRAM_SIZE]; };
+
+  uint8_t addressCounter() { return _ac; };
+  bool cgramSelected() { return _cgSelected; };
+  uint8_t entryMode() { return _entryMode; };
+  uint8_t displayControl() { return _displayControl; };
+  uint8_t functionSet() { return _functionSet; };
+  uint8_t displayShift() { return _shift; };
+
+  /** @brief Instructions and data writes executed since reset */
+  uint32_t executed() { return _executed; };
+
+  /** @brief Instructions and data writes dropped because the controller was busy */
+  uint32_t overruns() { return _overruns; };
+
+private:
+  void execute(uint8_t value, bool rs);
+  void instruction(uint8_t value);
+  void writeRam(uint8_t value);
+  uint8_t readRam();
+  void stepAddress(bool increment);
+  void shiftDisplay(bool left);
+  uint8_t ddramIndex(uint8_t addr);
+  uint8_t lineLength();
+
+  uint8_t _ddram[HD44780_DDRAM_SIZE]; // By linear index, line 2 starts at 40 in 2 line mode
+  uint8_t _cgram[HD44780_CGRAM_SIZE];
+
+  uint8_t _ac;             // Address counter, DDRAM 0x00-0x67 or CGRAM 0x00-0x3F
+  bool _cgSelected;        // Last address set was a CGRAM one
+  uint8_t _entryMode;      // LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_INCREMENT bits
+  uint8_t _displayControl; // LCD_DISPLAY_ON | LCD_CURSOR_ON | LCD_BLINK_ON bits
+  uint8_t _functionSet;    // LCD_8BIT_MODE | LCD_2_LINE | LCD_5x10DOTS bits
+  uint8_t _shift;          // Display shift, in characters to the left
+
+  bool _lowNibble;         // 4 bit interface: next strobe carries the low nibble
+  uint8_t _highNibble;     // 4 bit interface: high nibble already received
+  bool _nibbleOverrun;     // 4 bit interface: it came while busy
+  uint8_t _readLatch;      // 4 bit interface: byte being read out
+
+  uint32_t _issuedAt;      // micros() when the last instruction started
+  uint32_t _execTime;      // Its execution time
+  uint32_t _executed;
+  uint32_t _overruns;
+};
+
+/** @brief LCD driver rendering into an HD44780 model instead of real pins
+ *
+ *  Behaves like the parallel driver: every send() is strobed into the model and
+ *  then waits the bus time. Tests read the rendered screen back with charAt()
+ *  or readRow() and time API calls with micros().
+ *  Displays with more cells than one DDRAM holds (40x4) get a second controller
+ *  for rows 2-3, like the real modules.
+ *  charAt() and readRow() map cells with the panel wiring of the common modules,
+ *  not with the driver's row offsets, so that tests catch a wrong layout: rows
+ *  at 0x00, 0x40, cols and 0x40 + cols, and a 16x1 panel wired as 8x2.
+ */
+class HD44780Emulator : public VirtLiquidCrystal
+{
+public:
+  HD44780Emulator(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS,
+                  uint8_t bitmode = LCD_4BIT_MODE);
+
+  void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE);
+  void setBacklight(uint8_t value);
+
+  /** @brief Microseconds each send() holds the caller, default HD44780_EXEC_DEFAULT */
+  void setBusTime(uint16_t busTime) { _busTime = busTime; };
+
+  /** @brief Character shown at a cell */
+  uint8_t charAt(uint8_t col, uint8_t row);
+
+  /** @brief Copy a displayed row into buffer, NUL terminated (cols + 1 bytes) */
+  void readRow(uint8_t row, char *buffer);
+
+  /** @brief Backlight level last set */
+  uint8_t getBacklight() { return _backlight; };
+
+  /** @brief A controller model, for RAM and register level checks
+   *
+   *  @param index 0, or 1 for the rows 2-3 controller of dual controller displays
+   */
+  HD44780 &controller(uint8_t index = 0) { return _lcd[index & 0x01]; };
+
+protected:
+  uint8_t beginTransport();
+  uint8_t bitMode() { return _bitmode; };
+  void send(uint8_t value, uint8_t mode);
+  bool canReadStatus() { return (controllers() == 1); };
+  uint8_t readStatus();
+  uint8_t controllers() { return (_cols * _rows > HD44780_DDRAM_SIZE) ? 2 : 1; };
+  void selectController(uint8_t mask) { _selected = mask; };
+  uint8_t interleaveBytes() { return 1; };
+
+private:
+  /** @brief DDRAM address the panel shows at a cell, on its controller */
+  uint8_t panelAddress(uint8_t col, uint8_t row);
+
+  HD44780 _lcd[2];
+  uint8_t _selected; // Controllers strobed, LCD_CONTROLLER_1 | LCD_CONTROLLER_2 bits
+  uint8_t _bitmode;
+  uint8_t _backlight;
+  uint16_t _busTime;
+};
+
+#endif // _HD44780Emulator_H_
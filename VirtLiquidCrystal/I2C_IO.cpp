@@ -15,54 +15,155 @@
 
 #include "I2C_IO.h"
 
+// MCP23017 registers, IOCON.BANK = 0 addressing (power on default)
+#define MCP23017_IODIRA 0x00
+#define MCP23017_IOCON 0x0A
+#define MCP23017_GPPUA 0x0C
+#define MCP23017_GPIOA 0x12
+#define MCP23017_OLATA 0x14
 
-I2C_IO::I2C_IO(uint8_t i2cAddr = I2C_NO_ADDR, uint8_t dirMask = I2C_MASK_INPUT, uint8_t pinShadow = I2C_NO_SHADOW)
+// IOCON: with BANK = 0 the register pointer then toggles between the A and B
+// register of a pair instead of moving on, so a stream of bytes after OLATA
+// updates both ports over and over like the PCF8575 does.
+#define MCP23017_SEQOP 0x20
+
+// Clocks selfTest() steps through, standard mode up to fast mode plus
+static const uint32_t testClocks[] = {100000, 200000, 400000, 800000, 1000000};
+
+// Written to the tested pins, every pin both ways and next to its opposite
+static const uint16_t testPatterns[] = {0x5555, 0xAAAA, 0x0000, 0xFFFF};
+
+
+I2C_IO::I2C_IO(uint8_t i2cAddr, uint16_t dirMask, uint16_t pinShadow)
 {
    init(i2cAddr, dirMask, pinShadow);
 }
 
-uint8_t I2C_IO::init(uint8_t i2cAddr = I2C_NO_ADDR, uint8_t dirMask = I2C_MASK_INPUT, uint8_t pinShadow = I2C_NO_SHADOW)
+I2C_IO::~I2C_IO()
+{
+}
+
+uint8_t I2C_IO::init(uint8_t i2cAddr, uint16_t dirMask, uint16_t pinShadow)
 {
+#ifdef LCD_STATS
+   resetCounters();
+#endif
+
    _i2cAddr = i2cAddr;
    _dirMask = dirMask;
    _pinShadow = pinShadow; 
+   _chip = I2C_IO_PCF8574;
+   _sampleAge = 0;
+   _sampled = false;
+   _clock = 0;
+   _backend = NULL;
+   _callback = NULL;
    _initialised = isAvailable(_i2cAddr);
    return _initialised;
 }
 
-uint8_t I2C_IO::begin()
+void I2C_IO::setChip(uint8_t chip)
+{
+   _chip = chip;
+}
+
+uint8_t I2C_IO::begin(uint32_t clock)
 {
+   if (clock != 0)
+   {
+      _clock = clock;
+   }
+   drain();
    Wire.begin();
+   applyClock();
 
    _initialised = isAvailable(_i2cAddr);
 
    if (_initialised)
    {
-#if (ARDUINO < 100)
-      _pinShadow = Wire.receive();
-#else
-      _pinShadow = Wire.read(); // Remove the byte read don't need it.
-#endif
+      // Nothing was requested to read the pins from, start from all low
+      _pinShadow = 0;
    
+      if (_chip == I2C_IO_MCP23017)
+      {
+         // IOCON shows at both addresses of the pair
+         writeRegisters(MCP23017_IOCON, (MCP23017_SEQOP << 8) | MCP23017_SEQOP);
+      }
       portMode ( OUTPUT );
-      write(LOW);
+      if (_chip == I2C_IO_PCF8574)
+      {
+         write(LOW);
+      }
+      else
+      {
+         write16(0); // both ports, the LCD control lines are on the second one
+      }
    }
    return (_initialised);
 }
 
 
+void I2C_IO::setClock(uint32_t clock)
+{
+   _clock = clock;
+   if (_initialised)
+   {
+      drain();
+      applyClock();
+   }
+}
+
+
+i2c_io_speed_t I2C_IO::selfTest(uint16_t pinMask, uint32_t maxClock)
+{
+   i2c_io_speed_t result = {0, 0};
+   uint16_t shadow = _pinShadow;
+
+   pinMask &= ~_dirMask; // outputs only
+
+   if (!_initialised)
+   {
+      return result;
+   }
+
+   for (uint8_t i = 0; i < sizeof(testClocks) / sizeof(testClocks[0]); i++)
+   {
+      if (testClocks[i] > maxClock)
+      {
+         break;
+      }
+      setClock(testClocks[i]);
+      if (!testPattern(pinMask))
+      {
+         break;
+      }
+      result.clock = testClocks[i];
+   }
+
+   // Settle on the fastest clock that worked, the slowest one if none did
+   setClock((result.clock != 0) ? result.clock : testClocks[0]);
+   write16(shadow);
+   if (result.clock != 0)
+   {
+      result.framesPerSecond = measureFrameRate();
+   }
+   return result;
+}
+
+
 void I2C_IO::pinMode(uint8_t pin, uint8_t dir)
 {
    if (_initialised)
    {
       if (OUTPUT == dir)
       {
-         _dirMask &= ~(1 << pin);
+         _dirMask &= ~((uint16_t)1 << pin);
       }
       else
       {
-         _dirMask |= (1 << pin);
+         _dirMask |= ((uint16_t)1 << pin);
       }
+      updateDirection();
    }
 }
 
@@ -74,12 +175,30 @@ void I2C_IO::portMode(uint8_t dir)
    {
       if (dir == INPUT)
       {
-         _dirMask = 0xFF;
+         _dirMask = 0xFFFF;
       }
       else
       {
-         _dirMask = 0x00;
+         _dirMask = 0x0000;
       }
+      updateDirection();
+   }
+}
+
+
+void I2C_IO::maskMode(uint16_t mask, uint8_t dir)
+{
+   if (_initialised)
+   {
+      if (dir == INPUT)
+      {
+         _dirMask |= mask;
+      }
+      else
+      {
+         _dirMask &= ~mask;
+      }
+      updateDirection();
    }
 }
 
@@ -88,69 +207,165 @@ uint8_t I2C_IO::read(void)
 {
    uint8_t retVal = 0;
 
-   if (_initialised)
+   read(&retVal, 1);
+   return (retVal);
+}
+
+
+uint8_t I2C_IO::read(uint8_t *samples, uint8_t count)
+{
+   uint8_t received = request(count);
+
+   for (uint8_t i = 0; i < received; i++)
    {
-      Wire.requestFrom(_i2cAddr, (uint8_t)1);
-#if (ARDUINO < 100)
-      retVal = (_dirMask & Wire.receive());
-#else
-      retVal = (_dirMask & Wire.read());
-#endif
+      samples[i] = (uint8_t)receive();
    }
+   return (received);
+}
+
+
+uint16_t I2C_IO::read16(void)
+{
+   uint16_t retVal = 0;
+
+   read16(&retVal, 1);
    return (retVal);
 }
 
 
-uint8_t I2C_IO::write(uint8_t value)
+uint8_t I2C_IO::read16(uint16_t *samples, uint8_t count)
+{
+   uint8_t received = request(count);
+
+   for (uint8_t i = 0; i < received; i++)
+   {
+      samples[i] = receive();
+   }
+   return (received);
+}
+
+
+void I2C_IO::setSampleAge(uint32_t maxAge)
+{
+   _sampleAge = maxAge;
+}
+
+
+int I2C_IO::write(uint8_t value)
+{
+   return write16((_pinShadow & 0xFF00) | value);
+}
+
+
+int I2C_IO::write(const uint8_t *values, uint8_t size)
 {
    uint8_t status = 0;
 
    if (_initialised)
    {
-      // Only write HIGH the values of the ports that have been initialised as
-      // outputs updating the output shadow of the device
-      _pinShadow = (value & ~(_dirMask)); //_shadow = ( value | _dirMask );
+      uint8_t capacity = framesPerWrite();
 
-      Wire.beginTransmission(_i2cAddr);
-#if (ARDUINO < 100)
-      Wire.send(_pinShadow);
-#else
-      Wire.write(_pinShadow);
-#endif
-      status = Wire.endTransmission();
+      while ((size > 0) && (status == 0))
+      {
+         uint8_t chunk = (size > capacity) ? capacity : size;
+
+         beginWrite();
+         for (uint8_t i = 0; i < chunk; i++)
+         {
+            put((_pinShadow & 0xFF00) | values[i]);
+         }
+         status = endWrite();
+
+         values += chunk;
+         size -= chunk;
+      }
+   }
+   return ((status == 0));
+}
+
+
+int I2C_IO::write16(uint16_t value)
+{
+   return write16(&value, 1);
+}
+
+
+int I2C_IO::write16(const uint16_t *values, uint8_t size)
+{
+   uint8_t status = 0;
+
+   if (_initialised)
+   {
+      uint8_t capacity = framesPerWrite();
+
+      while ((size > 0) && (status == 0))
+      {
+         uint8_t chunk = (size > capacity) ? capacity : size;
+
+         beginWrite();
+         for (uint8_t i = 0; i < chunk; i++)
+         {
+            put(values[i]);
+         }
+         status = endWrite();
+
+         values += chunk;
+         size -= chunk;
+      }
    }
    return ((status == 0));
 }
 
 
+uint8_t I2C_IO::framesPerWrite()
+{
+   switch (_chip)
+   {
+   case I2C_IO_PCF8575:
+      return (I2C_IO_BUFFER_LENGTH / 2);
+   case I2C_IO_MCP23017:
+      return ((I2C_IO_BUFFER_LENGTH - 1) / 2); // after the register address
+   default:
+      return I2C_IO_BUFFER_LENGTH;
+   }
+}
+
+
 uint8_t I2C_IO::digitalRead(uint8_t pin)
 {
-   uint8_t pinVal = 0;
+   uint16_t pinVal = 0; // 16 pins on a PCF8575 or MCP23017
 
    // Check if initialised and that the pin is within range of the device
    // -------------------------------------------------------------------
-   if ((_initialised) && (pin <= 7))
+   if ((_initialised) && (pin < width()))
    {
       // Remove the values which are not inputs and get the value of the pin
-      pinVal = this->read() & _dirMask;
+      if (_sampled && ((micros() - _sampledAt) < _sampleAge))
+      {
+         pinVal = _sample & _dirMask;
+      }
+      else
+      {
+         pinVal = this->read16() & _dirMask;
+      }
       pinVal = (pinVal >> pin) & 0x01; // Get the pin value
    }
-   return (pinVal);
+   return ((uint8_t)pinVal);
 }
 
 
-uint8_t I2C_IO::digitalWrite(uint8_t pin, uint8_t level)
+int I2C_IO::digitalWrite(uint8_t pin, uint8_t level)
 {
-   uint8_t writeVal;
+   uint16_t writeVal;
    uint8_t status = 0;
 
    // Check if initialised and that the pin is within range of the device
    // -------------------------------------------------------------------
-   if ((_initialised) && (pin <= 7))
+   if ((_initialised) && (pin < width()))
    {
       // Only write to HIGH the port if the port has been configured as
       // an OUTPUT pin. Add the new state of the pin to the shadow
-      writeVal = (1 << pin) & ~_dirMask;
+      writeVal = ((uint16_t)1 << pin) & ~_dirMask;
       if (level == HIGH)
       {
          _pinShadow |= writeVal;
@@ -159,11 +374,92 @@ uint8_t I2C_IO::digitalWrite(uint8_t pin, uint8_t level)
       {
          _pinShadow &= ~writeVal;
       }
-      status = this->write(_pinShadow);
+      status = this->write16(_pinShadow);
    }
    return (status);
 }
 
+void I2C_IO::setBackend(I2C_IOBackend *backend, i2c_io_transfer_t *transfers, uint8_t count)
+{
+   drain();
+   _tHead = 0;
+   _tTail = 0;
+   _inFlight = false;
+   _transfers = transfers;
+   _slots = count;
+   _backend = ((transfers != NULL) && (count >= 2)) ? backend : NULL;
+}
+
+
+void I2C_IO::onComplete(i2c_io_callback_t callback, void *context)
+{
+   _callback = callback;
+   _context = context;
+}
+
+
+uint8_t I2C_IO::pending()
+{
+   if (_backend == NULL)
+   {
+      return 0;
+   }
+   return (uint8_t)((_tHead + _slots - _tTail) % _slots);
+}
+
+
+void I2C_IO::service()
+{
+   if (_backend != NULL)
+   {
+      _backend->poll();
+      launch();
+   }
+}
+
+
+void I2C_IO::drain()
+{
+   while (pending() > 0)
+   {
+      service();
+   }
+}
+
+
+void I2C_IO::complete(uint8_t status)
+{
+   _tTail = (_tTail + 1) % _slots;
+   _inFlight = false;
+
+#ifdef LCD_STATS
+   _transactions++;
+   if ((status == 2) || (status == 3))
+   {
+      _nacks++;
+   }
+#endif
+
+   if (_callback != NULL)
+   {
+      _callback(_context, status);
+   }
+   launch();
+}
+
+
+bool I2C_IOSyncBackend::start(I2C_IO *port, uint8_t i2cAddr, const uint8_t *data, uint8_t size)
+{
+   Wire.beginTransmission(i2cAddr);
+#if (ARDUINO < 100)
+   Wire.send((uint8_t *)data, size);
+#else
+   Wire.write(data, size);
+#endif
+   port->complete(Wire.endTransmission());
+   return true;
+}
+
 //
 // PRIVATE METHODS
 // ---------------------------------------------------------------------------
@@ -172,8 +468,296 @@ bool I2C_IO::isAvailable(uint8_t i2cAddr)
    int ret;
 
    Wire.beginTransmission(i2cAddr);
-   ret = Wire.endTransmission();
+   ret = endTransmission();
 
    return (ret == 0) ? true : false; //false if err
    
 }
+
+// Counts the transaction when LCD_STATS is defined.
+// Queued transactions are counted as they complete.
+// Status 2 and 3 are the address and data NACKs.
+uint8_t I2C_IO::endTransmission()
+{
+   uint8_t status = Wire.endTransmission();
+
+#ifdef LCD_STATS
+   _transactions++;
+   if ((status == 2) || (status == 3))
+   {
+      _nacks++;
+   }
+#endif
+   return status;
+}
+
+// The MCP23017 needs the register address first.
+// With a backend the transaction is built in the free queue entry, waiting
+// for the oldest one to complete if there is none.
+void I2C_IO::beginWrite()
+{
+   if (_backend != NULL)
+   {
+      while (pending() >= _slots - 1)
+      {
+         service();
+      }
+      _transfers[_tHead].size = 0;
+   }
+   else
+   {
+      Wire.beginTransmission(_i2cAddr);
+   }
+
+   if (_chip == I2C_IO_MCP23017)
+   {
+      emit(MCP23017_OLATA);
+   }
+}
+
+void I2C_IO::emit(uint8_t value)
+{
+   if (_backend != NULL)
+   {
+      i2c_io_transfer_t *transfer = &_transfers[_tHead];
+      transfer->data[transfer->size++] = value;
+   }
+   else
+   {
+#if (ARDUINO < 100)
+      Wire.send(value);
+#else
+      Wire.write(value);
+#endif
+   }
+}
+
+// Queued transactions report their status to the callback
+uint8_t I2C_IO::endWrite()
+{
+   if (_backend == NULL)
+   {
+      return endTransmission();
+   }
+
+   _tHead = (_tHead + 1) % _slots;
+   launch();
+   return 0;
+}
+
+// Hand the oldest queued transaction to the backend unless it already has one.
+// No lock needed: completions only happen while _inFlight is set, and a
+// completion launches whatever was queued before it.
+void I2C_IO::launch()
+{
+   if (_inFlight || (_tTail == _tHead))
+   {
+      return;
+   }
+
+   _inFlight = true;
+   if (!_backend->start(this, _i2cAddr, _transfers[_tTail].data, _transfers[_tTail].size))
+   {
+      _inFlight = false; // bus taken by another port, service() retries
+   }
+}
+
+// Only write the values of the ports that have been initialised as
+// outputs updating the output shadow of the device. Inputs are written
+// HIGH, the PCF8574 can only read pins it is not pulling down.
+void I2C_IO::put(uint16_t value)
+{
+   _pinShadow = (value & ~(_dirMask)) | _dirMask;
+
+   emit((uint8_t)_pinShadow);
+   if (_chip != I2C_IO_PCF8574)
+   {
+      emit((uint8_t)(_pinShadow >> 8));
+   }
+}
+
+// Ask for count port samples, returns how many arrived
+uint8_t I2C_IO::request(uint8_t count)
+{
+   uint8_t size = (_chip == I2C_IO_PCF8574) ? 1 : 2;
+
+   if (!_initialised || (count == 0))
+   {
+      return 0;
+   }
+   drain();
+   if (count > (I2C_IO_BUFFER_LENGTH / size))
+   {
+      count = I2C_IO_BUFFER_LENGTH / size;
+   }
+
+   if (_chip == I2C_IO_MCP23017)
+   {
+      Wire.beginTransmission(_i2cAddr);
+#if (ARDUINO < 100)
+      Wire.send(MCP23017_GPIOA);
+#else
+      Wire.write(MCP23017_GPIOA);
+#endif
+      endTransmission();
+   }
+
+   Wire.requestFrom(_i2cAddr, (uint8_t)(count * size));
+#ifdef LCD_STATS
+   _transactions++;
+#endif
+
+   count = Wire.available() / size;
+   if (count > 0)
+   {
+      _sampledAt = micros();
+      _sampled = true;
+   }
+   return count;
+}
+
+// Next port sample of a request(), inputs only
+uint16_t I2C_IO::receive()
+{
+#if (ARDUINO < 100)
+   _sample = Wire.receive();
+   if (_chip != I2C_IO_PCF8574)
+   {
+      _sample |= (uint16_t)Wire.receive() << 8;
+   }
+#else
+   _sample = Wire.read();
+   if (_chip != I2C_IO_PCF8574)
+   {
+      _sample |= (uint16_t)Wire.read() << 8;
+   }
+#endif
+   return (_dirMask & _sample);
+}
+
+// Write the A and B register of a pair, MCP23017 only
+uint8_t I2C_IO::writeRegisters(uint8_t reg, uint16_t value)
+{
+   drain();
+   Wire.beginTransmission(_i2cAddr);
+#if (ARDUINO < 100)
+   Wire.send(reg);
+   Wire.send((uint8_t)value);
+   Wire.send((uint8_t)(value >> 8));
+#else
+   Wire.write(reg);
+   Wire.write((uint8_t)value);
+   Wire.write((uint8_t)(value >> 8));
+#endif
+   return endTransmission();
+}
+
+void I2C_IO::applyClock()
+{
+#if (ARDUINO >= 10600)
+   if (_clock != 0)
+   {
+      Wire.setClock(_clock);
+   }
+#endif
+}
+
+// Write each pattern to the pins in pinMask and read it back, any NACK or
+// difference fails
+bool I2C_IO::testPattern(uint16_t pinMask)
+{
+   for (uint8_t round = 0; round < I2C_IO_TEST_ROUNDS; round++)
+   {
+      for (uint8_t i = 0; i < sizeof(testPatterns) / sizeof(testPatterns[0]); i++)
+      {
+         uint16_t value = (_pinShadow & ~pinMask) | (testPatterns[i] & pinMask);
+
+         if (!write16(value) || (request(1) != 1))
+         {
+            return false;
+         }
+         receive();
+         if ((_sample & pinMask) != (value & pinMask))
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+// Time full Wire buffers of the current port value, returns port updates per second
+uint32_t I2C_IO::measureFrameRate()
+{
+   uint16_t frames[I2C_IO_BUFFER_LENGTH];
+   uint8_t size = framesPerWrite();
+   uint32_t elapsed;
+
+   for (uint8_t i = 0; i < size; i++)
+   {
+      frames[i] = _pinShadow;
+   }
+
+   uint32_t start = micros();
+   for (uint8_t round = 0; round < I2C_IO_TEST_ROUNDS; round++)
+   {
+      write16(frames, size);
+   }
+   drain();
+   elapsed = micros() - start;
+
+   if (elapsed == 0)
+   {
+      return 0;
+   }
+   return ((uint32_t)size * I2C_IO_TEST_ROUNDS * 1000000UL) / elapsed;
+}
+
+// The MCP23017 has real direction registers, pull-ups on the inputs make its
+// pins read like the quasi-bidirectional PCF857x ones
+void I2C_IO::updateDirection()
+{
+   if (_chip == I2C_IO_MCP23017)
+   {
+      writeRegisters(MCP23017_IODIRA, _dirMask);
+      writeRegisters(MCP23017_GPPUA, _dirMask);
+   }
+}
+
+#ifdef LCD_STATS
+uint32_t I2C_IO::transactions()
+{
+   return readCounter(&_transactions);
+}
+
+uint32_t I2C_IO::nacks()
+{
+   return readCounter(&_nacks);
+}
+
+void I2C_IO::resetCounters()
+{
+#ifdef __AVR__
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+   {
+      _transactions = 0;
+      _nacks = 0;
+   }
+}
+
+// complete() may run in an interrupt. A 32 bit load takes several instructions
+// on AVR, elsewhere it is a single one.
+uint32_t I2C_IO::readCounter(volatile uint32_t *counter)
+{
+   uint32_t value;
+
+#ifdef __AVR__
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+   {
+      value = *counter;
+   }
+   return value;
+}
+#endif
@@ -15,48 +15,316 @@
 #endif
 #include <inttypes.h>
 
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
 #define I2C_NO_ADDR 0x0
-#define I2C_NO_MASK 0xFF
+#define I2C_NO_MASK 0xFFFF
 #define I2C_NO_SHADOW 0x0
 
+// Supported port expanders, see setChip()
+#define I2C_IO_PCF8574 0  // 8 bit quasi-bidirectional port
+#define I2C_IO_PCF8575 1  // 16 bit quasi-bidirectional port, P00-P07 then P10-P17
+#define I2C_IO_MCP23017 2 // 16 bit register based, GPIOA then GPIOB
+
+// Number of bytes the Wire library can queue in a single transmission
+#if defined(I2C_BUFFER_LENGTH)
+#define I2C_IO_BUFFER_LENGTH I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define I2C_IO_BUFFER_LENGTH BUFFER_LENGTH
+#else
+#define I2C_IO_BUFFER_LENGTH 32
+#endif
+
+// Fastest clock selfTest() tries by default, I2C fast mode plus
+#define I2C_IO_MAX_CLOCK 1000000
+
+// Pattern writes per clock in selfTest(), and full Wire buffers timed for the frame rate
+#define I2C_IO_TEST_ROUNDS 4
+
+/*!
+ @brief Result of I2C_IO::selfTest().
+ */
+typedef struct
+{
+   uint32_t clock;           // Fastest clock that passed, Hz, 0 if none did
+   uint32_t framesPerSecond; // Port updates per second measured at that clock
+} i2c_io_speed_t;
+
+/*!
+ @brief Transaction waiting in the queue of an asynchronous I2C_IO, see setBackend().
+ */
+typedef struct
+{
+   uint8_t size;                       // Bytes in data
+   uint8_t data[I2C_IO_BUFFER_LENGTH]; // Register address (MCP23017) and port values
+} i2c_io_transfer_t;
+
+/*!
+ @brief Called as each queued transaction leaves the bus, from the backend
+ completion context (possibly an interrupt).
+ @param status Wire.endTransmission() code, 0 on success.
+ */
+typedef void (*i2c_io_callback_t)(void *context, uint8_t status);
+
+class I2C_IO;
+
+/*!
+ @class
+ @brief    I2C_IOBackend
+ @note  I2C master clocking out whole transactions on its own, from an
+ interrupt or a DMA channel. start() only sets the transfer up; the backend
+ reports its end with I2C_IO::complete(), after which it may be given the next
+ one from within that call. Backends without a completion interrupt finish
+ transfers in poll(). One backend can serve several ports on its bus.
+ */
+class I2C_IOBackend
+{
+public:
+   virtual ~I2C_IOBackend() {};
+
+   /*!
+    @brief Start writing size bytes to i2cAddr for port.
+    @note data stays valid until port->complete() is called.
+    @return false if a transfer is already on the bus, the port retries later.
+    */
+   virtual bool start(I2C_IO *port, uint8_t i2cAddr, const uint8_t *data, uint8_t size) = 0;
+
+   /*!
+    @brief Check for the end of the transfer, for backends without interrupts.
+    */
+   virtual void poll() {};
+};
+
+/*!
+ @class
+ @brief    I2C_IOSyncBackend
+ @note  Synchronous fallback for targets without an asynchronous I2C master:
+ start() runs the transaction through the Wire library and completes it on
+ return. Writes block like without a backend but callbacks still run.
+ */
+class I2C_IOSyncBackend : public I2C_IOBackend
+{
+public:
+   bool start(I2C_IO *port, uint8_t i2cAddr, const uint8_t *data, uint8_t size);
+};
+
 /*!
  @class
  @brief    I2C_IO
  @note  Library driver to control PCF8574 based ASICs. Implementing
  library calls to set/get port through I2C bus.
+ The 16 bit PCF8575 and MCP23017 are handled as one 16 bit port, pins 0-7 on
+ the first port (P00-P07, GPIOA) and 8-15 on the second. The 8 bit calls
+ work on the first port and leave the second as it is.
  */
 
 class I2C_IO
 {
 public:
    
-   I2C_IO(uint8_t i2cAddr = I2C_NO_ADDR, uint8_t dirMask = I2C_NO_MASK, uint8_t pinShadow = I2C_NO_SHADOW);
+   I2C_IO(uint8_t i2cAddr = I2C_NO_ADDR, uint16_t dirMask = I2C_NO_MASK, uint16_t pinShadow = I2C_NO_SHADOW);
 
    ~I2C_IO();
 
-   uint8_t init(uint8_t i2cAddr = I2C_NO_ADDR, uint8_t dirMask = I2C_NO_MASK, uint8_t pinShadow = I2C_NO_SHADOW);
+   uint8_t init(uint8_t i2cAddr = I2C_NO_ADDR, uint16_t dirMask = I2C_NO_MASK, uint16_t pinShadow = I2C_NO_SHADOW);
+
+   /*!
+    @brief Select the expander, I2C_IO_PCF8574 (default), I2C_IO_PCF8575 or
+    I2C_IO_MCP23017. Call before begin().
+    */
+   void setChip(uint8_t chip);
+
+   /*!
+    @brief Number of port pins, 8 or 16.
+    */
+   uint8_t width() { return (_chip == I2C_IO_PCF8574) ? 8 : 16; };
 
-   uint8_t begin();
+   /*!
+    @brief Start the bus and set the port up.
+    @param clock SCL frequency in Hz, 0 (default) keeps the one given to
+    setClock(), if any, or else whatever the Wire library runs at.
+    @note The clock is the bus one, shared by every device on it.
+    */
+   uint8_t begin(uint32_t clock = 0);
+
+   /*!
+    @brief SCL frequency in Hz begin() starts the bus at, applied at once if
+    the port is already running. 0 leaves the Wire library clock alone.
+    */
+   void setClock(uint32_t clock);
+   uint32_t getClock() { return _clock; };
+
+   /*!
+    @brief Find the fastest clock the wiring carries, up to maxClock.
+    @note Tries 100kHz, 200kHz, 400kHz, 800kHz and 1MHz in turn. At each one the
+    output pins in pinMask get patterns written and read back; the first clock
+    with a NACK or a wrong read back ends the test. The bus is left at the
+    fastest clock that passed and the port as it was.
+    Only outputs can be checked, input pins in pinMask are ignored. Other
+    outputs keep their level, so this is safe with an LCD on the port as long
+    as its enable line is not in pinMask.
+    @return The clock picked and the port updates per second it reaches with
+    full Wire buffers (see framesPerWrite()).
+    */
+   i2c_io_speed_t selfTest(uint16_t pinMask, uint32_t maxClock = I2C_IO_MAX_CLOCK);
 
    void pinMode(uint8_t pin, uint8_t dir);
 
    void portMode(uint8_t dir);
 
+   /*!
+    @brief Set the direction of all the pins set in mask.
+    */
+   void maskMode(uint16_t mask, uint8_t dir);
+
    uint8_t read(void);
 
+   /*!
+    @brief Read count consecutive port samples in a single I2C transaction.
+    @note The PCF8574 samples its pins on every byte it sends, so the samples
+    are one byte time apart on the bus, equal samples mean settled inputs.
+    Inputs only like read(), the last sample refreshes the digitalRead() cache.
+    @return Number of samples read.
+    */
+   uint8_t read(uint8_t *samples, uint8_t count);
+
+   /*!
+    @brief read() and read(samples, count) for the whole 16 bit port.
+    */
+   uint16_t read16(void);
+   uint8_t read16(uint16_t *samples, uint8_t count);
+
+   /*!
+    @brief Let digitalRead() use the last port sample while it is younger than
+    maxAge microseconds, so several pins polled together cost one bus read.
+    @note 0 (default) reads the bus on every digitalRead().
+    */
+   void setSampleAge(uint32_t maxAge);
+
    uint8_t digitalRead(uint8_t pin);
 
    int write(uint8_t value);
 
+   /*!
+    @brief Write a sequence of port values in as few I2C transactions as possible.
+    @note Each byte is latched by the expander as it is received, so a whole
+    pulse sequence can be clocked out without a stop/start per port update.
+    The sequence is split only when it exceeds the Wire buffer.
+    */
+   int write(const uint8_t *values, uint8_t size);
+
+   /*!
+    @brief write() and write(values, size) for the whole 16 bit port.
+    */
+   int write16(uint16_t value);
+   int write16(const uint16_t *values, uint8_t size);
+
+   /*!
+    @brief Most port values write(values, size) sends in one I2C transaction.
+    */
+   uint8_t framesPerWrite();
+
    int digitalWrite(uint8_t pin, uint8_t level);
 
+   /*!
+    @brief Queue port writes for an asynchronous backend instead of blocking
+    in Wire.endTransmission().
+    @note Each write becomes one queued transaction of up to framesPerWrite()
+    port values and returns once it is queued, so writes cost the CPU the
+    copy only. With the queue full they wait for the oldest transaction to
+    finish. Reads, direction changes and begin() first wait for the queue to
+    empty, then use the Wire library.
+    @param backend NULL to write through the Wire library again (default).
+    @param transfers Queue storage, count - 1 transactions can be pending.
+    @param count Entries in transfers, at least 2.
+    */
+   void setBackend(I2C_IOBackend *backend, i2c_io_transfer_t *transfers, uint8_t count);
+
+   /*!
+    @brief Call callback with context as each queued transaction completes,
+    NULL for none.
+    */
+   void onComplete(i2c_io_callback_t callback, void *context = NULL);
+
+   /*!
+    @brief Queued transactions not completed yet, the one on the bus included.
+    */
+   uint8_t pending();
+
+   /*!
+    @brief Let a backend without interrupts move on, and retry a transaction
+    refused while the backend was busy with another port. Call from the main
+    loop when backends are polled or shared.
+    */
+   void service();
+
+   /*!
+    @brief Wait until every queued transaction is completed.
+    */
+   void drain();
+
+   /*!
+    @brief Backend side: the transaction on the bus has ended with status.
+    */
+   void complete(uint8_t status);
+
+#ifdef LCD_STATS
+   /*!
+    @brief Number of I2C transactions and of those not acknowledged, since
+    the last resetCounters().
+    @note A backend completing from an interrupt updates them, they are read
+    with interrupts off on AVR.
+    */
+   uint32_t transactions();
+   uint32_t nacks();
+   void resetCounters();
+#endif
+
 private:
-   uint8_t _pinShadow;   // Shadow output
-   uint8_t _dirMask;  // Direction mask
+   uint16_t _pinShadow;   // Shadow output
+   uint16_t _dirMask;  // Direction mask
    uint8_t _i2cAddr;  // I2C address
+   uint8_t _chip;     // I2C_IO_PCF8574, I2C_IO_PCF8575 or I2C_IO_MCP23017
    bool _initialised; // Initialised object
+   uint32_t _clock;   // SCL frequency, 0 to leave the Wire library one
+
+   uint16_t _sample;    // Port as last read, outputs included
+   uint32_t _sampledAt; // micros() of that read
+   uint32_t _sampleAge; // Longest time digitalRead() reuses it, 0 to never
+   bool _sampled;       // _sample holds a read
+
+   I2C_IOBackend *_backend;       // Asynchronous writes, NULL for the Wire library
+   i2c_io_transfer_t *_transfers; // Ring of queued transactions, the oldest is on the bus
+   uint8_t _slots;                // Entries in _transfers
+   volatile uint8_t _tHead;       // Next free entry, written by the caller
+   volatile uint8_t _tTail;       // Oldest pending entry, written on completion
+   volatile bool _inFlight;       // The backend has the _tTail transaction
+   i2c_io_callback_t _callback;
+   void *_context;
+
+#ifdef LCD_STATS
+   uint32_t readCounter(volatile uint32_t *counter);
+
+   volatile uint32_t _transactions; // Also counted by complete()
+   volatile uint32_t _nacks;
+#endif
 
    bool isAvailable(uint8_t i2cAddr);
+   uint8_t endTransmission();
+   void beginWrite();
+   void emit(uint8_t value);
+   uint8_t endWrite();
+   void launch();
+   void put(uint16_t value);
+   uint8_t request(uint8_t count);
+   uint16_t receive();
+   uint8_t writeRegisters(uint8_t reg, uint16_t value);
+   void updateDirection();
+   void applyClock();
+   bool testPattern(uint16_t pinMask);
+   uint32_t measureFrameRate();
 };
 
 #endif
\ No newline at end of file
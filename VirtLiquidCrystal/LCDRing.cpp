@@ -0,0 +1,168 @@
+#include <inttypes.h>
+
+#if (ARDUINO < 100)
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
+#include "LCDRing.h"
+
+#define LCD_RING_MASK (LCD_RING_SIZE - 1)
+
+// Single byte accesses are atomic everywhere. On a single core (AVR) only the
+// compiler must keep the order, between cores the index loads acquire and the
+// stores release so that a slot is complete before its index moves past it.
+#ifdef __AVR__
+#define LCD_RING_LOAD(x) (x)
+#define LCD_RING_STORE(x, v) ((x) = (v))
+#define LCD_RING_FENCE_ACQUIRE() __asm__ __volatile__("" ::: "memory")
+#define LCD_RING_FENCE_RELEASE() __asm__ __volatile__("" ::: "memory")
+#else
+#define LCD_RING_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define LCD_RING_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define LCD_RING_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define LCD_RING_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+LCDRing::LCDRing(VirtLiquidCrystal &lcd, uint8_t policy)
+{
+   _lcd = &lcd;
+   _policy = policy;
+   _head = 0;
+   _tail = 0;
+   _dropped = 0;
+
+   for (uint8_t i = 0; i < LCD_RING_SIZE; i++)
+   {
+      _slots[i].stamp = i + 1; // holds nothing
+   }
+}
+
+// The slot is marked as being written first, so a consumer reading it at the
+// same time (drop oldest) sees the stamp change and doesn't trust the copy
+bool LCDRing::post(const lcd_ring_op_t &op)
+{
+   uint8_t head = _head;
+   bool full = ((uint8_t)(head - LCD_RING_LOAD(_tail)) >= LCD_RING_SIZE);
+
+   if (full)
+   {
+      _dropped++;
+      if (_policy == LCD_RING_DROP_NEWEST)
+      {
+         return false;
+      }
+   }
+
+   volatile lcd_ring_slot_t *slot = &_slots[head & LCD_RING_MASK];
+
+   LCD_RING_STORE(slot->stamp, (uint8_t)(head + 1));
+   LCD_RING_FENCE_RELEASE();
+   slot->type = op.type;
+   slot->col = op.col;
+   slot->row = op.row;
+   slot->value = op.value;
+   LCD_RING_STORE(slot->stamp, head);
+   LCD_RING_STORE(_head, (uint8_t)(head + 1));
+   return !full;
+}
+
+bool LCDRing::postCell(uint8_t col, uint8_t row, uint8_t value)
+{
+   lcd_ring_op_t op = {LCD_RING_CELL, col, row, value};
+   return post(op);
+}
+
+bool LCDRing::postCursor(uint8_t col, uint8_t row)
+{
+   lcd_ring_op_t op = {LCD_RING_CURSOR, col, row, 0};
+   return post(op);
+}
+
+bool LCDRing::postMode(lcd_mode_t mode)
+{
+   lcd_ring_op_t op = {LCD_RING_MODE, 0, 0, (uint8_t)mode};
+   return post(op);
+}
+
+// With drop oldest the producer may have lapped the consumer: what it
+// overwrote is skipped, and a slot rewritten while being copied is dropped
+bool LCDRing::take(lcd_ring_op_t *op)
+{
+   for (;;)
+   {
+      uint8_t head = LCD_RING_LOAD(_head);
+      uint8_t tail = _tail;
+
+      if (head == tail)
+      {
+         return false;
+      }
+      if ((uint8_t)(head - tail) > LCD_RING_SIZE)
+      {
+         tail = head - LCD_RING_SIZE;
+      }
+
+      volatile lcd_ring_slot_t *slot = &_slots[tail & LCD_RING_MASK];
+      uint8_t stamp = LCD_RING_LOAD(slot->stamp);
+
+      op->type = slot->type;
+      op->col = slot->col;
+      op->row = slot->row;
+      op->value = slot->value;
+      LCD_RING_FENCE_ACQUIRE();
+
+      bool valid = (stamp == tail) && (slot->stamp == stamp);
+
+      LCD_RING_STORE(_tail, (uint8_t)(tail + 1));
+      if (valid)
+      {
+         return true;
+      }
+   }
+}
+
+// The producer may be an interrupt handler, and a 32 bit load takes several
+// instructions on AVR
+uint32_t LCDRing::dropped()
+{
+   uint32_t dropped;
+
+#ifdef __AVR__
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+   {
+      dropped = _dropped;
+   }
+   return dropped;
+}
+
+uint8_t LCDRing::drain(uint8_t maxOps)
+{
+   lcd_ring_op_t op;
+   uint8_t applied = 0;
+
+   while ((applied < maxOps) && take(&op))
+   {
+      switch (op.type)
+      {
+      case LCD_RING_CELL:
+         _lcd->setCursor(op.col, op.row);
+         _lcd->write(op.value);
+         break;
+      case LCD_RING_CURSOR:
+         _lcd->setCursor(op.col, op.row);
+         break;
+      case LCD_RING_MODE:
+         _lcd->display((lcd_mode_t)op.value);
+         break;
+      }
+      applied++;
+   }
+   return applied;
+}
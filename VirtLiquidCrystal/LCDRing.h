@@ -0,0 +1,101 @@
+/**
+ * @file LCDRing.h
+ * @brief Lock-free single producer, single consumer ring of display operations.
+ *
+ * An interrupt handler or a task on another core posts cell writes, cursor
+ * moves and mode changes for a display it must not drive itself; the task that
+ * owns the display drains them into it with drain(). Posting is a few stores and
+ * never waits: when the ring is full the newest or the oldest operation is
+ * dropped, depending on the policy.
+ * Drained into a display with a framebuffer, writes to the same cell between two
+ * flush() calls only cost the last one on the bus.
+ */
+
+#ifndef _LCDRing_H_
+#define _LCDRing_H_
+
+#include "VirtLiquidCrystal.h"
+
+/** @brief Operations the ring holds, a power of two up to 128 */
+#ifndef LCD_RING_SIZE
+#define LCD_RING_SIZE 16
+#endif
+
+/** @brief Overflow policies, see LCDRing() */
+#define LCD_RING_DROP_NEWEST 0 // post() fails, what is queued goes out
+#define LCD_RING_DROP_OLDEST 1 // post() overwrites the oldest operation, the latest state goes out
+                               // (drain at least every 256 - LCD_RING_SIZE posts, the sequence wraps)
+
+/** @brief Operation types */
+#define LCD_RING_CELL 0   // value at col, row
+#define LCD_RING_CURSOR 1 // setCursor(col, row)
+#define LCD_RING_MODE 2   // display((lcd_mode_t)value)
+
+/** @brief Posted operation */
+typedef struct
+{
+  uint8_t type; // LCD_RING_CELL, LCD_RING_CURSOR or LCD_RING_MODE
+  uint8_t col;
+  uint8_t row;
+  uint8_t value; // Character or lcd_mode_t
+} lcd_ring_op_t;
+
+class LCDRing
+{
+public:
+  /** @brief Ring feeding lcd
+   *
+   *  @param policy LCD_RING_DROP_NEWEST (default) or LCD_RING_DROP_OLDEST
+   */
+  LCDRing(VirtLiquidCrystal &lcd, uint8_t policy = LCD_RING_DROP_NEWEST);
+
+  //& Producer side, one interrupt handler or task --------------------------------------------------------------------------
+
+  /** @brief Queue an operation
+   *
+   *  @return false if it was dropped (LCD_RING_DROP_NEWEST) or overwrote one
+   *  the consumer hadn't taken yet (LCD_RING_DROP_OLDEST)
+   */
+  bool post(const lcd_ring_op_t &op);
+
+  bool postCell(uint8_t col, uint8_t row, uint8_t value);
+  bool postCursor(uint8_t col, uint8_t row);
+  bool postMode(lcd_mode_t mode);
+
+  //& Consumer side, the task driving the display --------------------------------------------------------------------------
+
+  /** @brief Apply queued operations to the display, oldest first
+   *
+   *  @param maxOps Apply at most this many
+   *  @return Number applied
+   */
+  uint8_t drain(uint8_t maxOps = LCD_RING_SIZE);
+
+  /** @brief Take the oldest queued operation without applying it, false if none */
+  bool take(lcd_ring_op_t *op);
+
+  /** @brief Operations lost to overflow since construction, counted by the producer */
+  uint32_t dropped();
+
+private:
+  // The stamp is the post sequence number the slot holds, or any other value
+  // while it is being written
+  typedef struct
+  {
+    uint8_t stamp;
+    uint8_t type;
+    uint8_t col;
+    uint8_t row;
+    uint8_t value;
+  } lcd_ring_slot_t;
+
+  volatile lcd_ring_slot_t _slots[LCD_RING_SIZE];
+  volatile uint8_t _head; // Posts so far, written by the producer only
+  volatile uint8_t _tail; // Operations taken so far, written by the consumer only
+
+  VirtLiquidCrystal *_lcd;
+  uint8_t _policy;
+  volatile uint32_t _dropped; // Refused or overwritten before being taken
+};
+
+#endif // _LCDRing_H_
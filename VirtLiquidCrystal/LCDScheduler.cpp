@@ -0,0 +1,80 @@
+#include <inttypes.h>
+
+#if (ARDUINO < 100)
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#include "LCDScheduler.h"
+
+LCDScheduler::LCDScheduler()
+{
+   _count = 0;
+   _next = 0;
+}
+
+bool LCDScheduler::add(VirtLiquidCrystal &lcd)
+{
+   if (_count >= LCD_SCHEDULER_SIZE)
+   {
+      return false;
+   }
+
+   lcd.setAsync(true);
+   _lcds[_count++] = &lcd;
+   return true;
+}
+
+void LCDScheduler::remove(VirtLiquidCrystal &lcd)
+{
+   for (uint8_t i = 0; i < _count; i++)
+   {
+      if (_lcds[i] == &lcd)
+      {
+         lcd.setAsync(false); // drains the queue
+         _lcds[i] = _lcds[--_count];
+         _next = 0;
+         return;
+      }
+   }
+}
+
+// A display whose controller is still executing (clear, home...) sends nothing
+// and its turn goes to the next one. Turns go on as long as one of them sent
+// something, so the bus stays busy while there is work that can go out.
+bool LCDScheduler::poll()
+{
+   bool pending = false;
+   bool sent = true;
+
+   if (_count == 0)
+   {
+      return false;
+   }
+
+   while (sent)
+   {
+      sent = false;
+      pending = false;
+
+      for (uint8_t i = 0; i < _count; i++)
+      {
+         VirtLiquidCrystal *lcd = _lcds[(_next + i) % _count];
+         uint8_t before = lcd->queued();
+
+         pending |= lcd->poll(1);
+         sent |= (lcd->queued() != before);
+      }
+   }
+
+   _next = (_next + 1) % _count;
+   return pending;
+}
+
+void LCDScheduler::flush()
+{
+   while (poll())
+   {
+   }
+}
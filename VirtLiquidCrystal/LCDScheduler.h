@@ -0,0 +1,59 @@
+/**
+ * @file LCDScheduler.h
+ * @brief Round-robin scheduler for several displays sharing one bus.
+ *
+ * Every display added is switched to asynchronous mode. poll() then hands out
+ * one queued operation per display per turn, so display B gets its bytes while
+ * display A is still executing a clear() instead of every display running its
+ * updates and delays serially.
+ */
+
+#ifndef _LCDScheduler_H_
+#define _LCDScheduler_H_
+
+#include "VirtLiquidCrystal.h"
+
+/** @brief Most displays one scheduler handles */
+#ifndef LCD_SCHEDULER_SIZE
+#define LCD_SCHEDULER_SIZE 8
+#endif
+
+class LCDScheduler
+{
+public:
+  LCDScheduler();
+
+  /** @brief Take over a display and switch it to asynchronous mode
+   *
+   *  An update bigger than LCD_QUEUE_SIZE operations blocks on its own display
+   *  until poll() frees slots, size the queue for the largest one.
+   *
+   *  @return false if LCD_SCHEDULER_SIZE displays are already handled
+   */
+  bool add(VirtLiquidCrystal &lcd);
+
+  /** @brief Give a display back, in blocking mode once its queue is drained */
+  void remove(VirtLiquidCrystal &lcd);
+
+  /** @brief Send ready operations one display at a time until none is ready
+   *
+   *  Call from the main loop. Each turn starts at the display after the one
+   *  that started the previous turn so that none is always served first.
+   *
+   *  @return true while some display has operations pending
+   */
+  bool poll();
+
+  /** @brief Block until every queued operation has been sent */
+  void flush();
+
+  /** @brief Number of displays handled */
+  uint8_t count() { return _count; };
+
+private:
+  VirtLiquidCrystal *_lcds[LCD_SCHEDULER_SIZE];
+  uint8_t _count;
+  uint8_t _next; // Display starting the next turn
+};
+
+#endif // _LCDScheduler_H_
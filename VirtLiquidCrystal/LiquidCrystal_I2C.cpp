@@ -12,140 +12,106 @@ LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t
   init(lcd_addr, lcd_cols, lcd_rows);
 }
 
-uint8_t LiquidCrystal_I2C::init(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows,
-                                uint8_t charsize = LCD_5x8DOTS, uint8_t En, uint8_t Rw, uint8_t Rs,
-                                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
-                                uint8_t backlighPin = 0, t_backlightPol pol = POSITIVE);
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows,
+                                     uint8_t charsize, uint8_t En, uint8_t Rw, uint8_t Rs,
+                                     uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                     uint8_t backlighPin, t_backlighPol pol)
 {
-  I2C_IO::init(lcd_addr);
-  _displayfunction = LCD_4BIT_MODE | LCD_1_LINE | charsize; //LCD_5x8DOTS
-  VirtLiquidCrystal::init(lcd_cols, lcd_rows, charsize);
+  init(lcd_addr, lcd_cols, lcd_rows, charsize, En, Rw, Rs, d4, d5, d6, d7, backlighPin, pol);
 }
 
-void config(uint8_t En, uint8_t Rw, uint8_t Rs,
-            uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
-            uint8_t backlighPin = 0, t_backlightPol pol = POSITIVE)
+uint8_t LiquidCrystal_I2C::init(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows,
+                                uint8_t charsize, uint8_t En, uint8_t Rw, uint8_t Rs,
+                                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                uint8_t backlighPin, t_backlighPol pol)
 {
   _En = (1 << En);
   _Rw = (1 << Rw);
   _Rs = (1 << Rs);
+  _polarity = pol;
 
-  // Initialise pin mapping
-  _data_pins[0] = (1 << d4);
-  _data_pins[1] = (1 << d5);
-  _data_pins[2] = (1 << d6);
-  _data_pins[3] = (1 << d7);
-
-  if (backlighPin)
-  {
-    setBacklightPin(backlighPin, pol);
-  }
-  else
-  {
-    _backlightPinMask = 0;
-    _backlightStsMask = LCD_NOBACKLIGHT;
-    _polarity = pol;
-  }
+  PCF8574Bus::config(lcd_addr, En, Rw, Rs, d4, d5, d6, d7, backlighPin, pol);
+  return VirtLiquidCrystal::init(lcd_cols, lcd_rows, charsize);
 }
 
-void LiquidCrystal_I2C::begin()
+void LiquidCrystal_I2C::setBacklightPin(uint8_t pin, t_backlighPol pol)
 {
-  if (!I2C_IO::begin())
-  {
-    return;
-  }
-  VirtLiquidCrystal::begin();
-  // home();
+  _polarity = pol;
+  PCF8574Bus::setBacklightPin(pin, pol);
 }
 
-void LiquidCrystal_I2C::setBacklightPin(uint8_t pin, t_backlightPol pol = POSITIVE)
+void LiquidCrystal_I2C::setBacklight(uint8_t value)
 {
-
-  _backlightPinMask = (1 << pin);
-  _polarity = pol;
-  setBacklight(0); // todo
+  PCF8574Bus::setBacklight(value);
 }
 
-void LiquidCrystal_I2C::setBacklight(uint8_t value)
+void LiquidCrystal_I2C::printstr(const char c[])
 {
-  // Check if backlight is available
-  // ----------------------------------------------------
-  if (_backlightPinMask != 0x0)
-  {
-    // Check for polarity to configure mask accordingly
-    // ----------------------------------------------------------
-    if (((_polarity == POSITIVE) && (value > 0)) ||
-        ((_polarity == NEGATIVE) && (value == 0)))
-    {
-      _backlightStsMask = _backlightPinMask & LCD_BACKLIGHT;
-    }
-    else
-    {
-      _backlightStsMask = _backlightPinMask & LCD_NOBACKLIGHT;
-    }
-    I2C_IO::write(_backlightStsMask);
-  }
+  // This function is not identical to the function used for "real" I2C displays
+  // it's here so the user sketch doesn't have to be changed
+  print(c);
 }
-uint8_t LiquidCrystal_I2C::getBacklight()
+
+/************ transport hooks **********/
+
+uint8_t LiquidCrystal_I2C::beginTransport()
 {
-  return _backlightStsMask;
+  return PCF8574Bus::beginTransport();
 }
 
-/************ low level data pushing commands **********/
+uint8_t LiquidCrystal_I2C::bitMode()
+{
+  return PCF8574Bus::bitMode();
+}
 
-// expanderWrite either command or data
 void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode)
 {
+  PCF8574Bus::send(value, mode);
+}
 
-  if (mode == FOUR_BITS)
-  {
-    write4bits((value & 0x0F), COMMAND);
-  }
-  else
-  {
-    write4bits((value >> 4), mode);
-    write4bits((value & 0x0F), mode);
-  }
+void LiquidCrystal_I2C::sendBuffer(const uint8_t *buffer, size_t size)
+{
+  PCF8574Bus::sendBuffer(buffer, size);
 }
 
-void LiquidCrystal_I2C::write4bits(uint8_t value, uint8_t mode)
+bool LiquidCrystal_I2C::canReadStatus()
 {
-  uint8_t pinMapValue = 0;
+  return PCF8574Bus::canReadStatus();
+}
 
-  // Map the value to LCD pin mapping
-  // --------------------------------
-  for (uint8_t i = 0; i < 4; i++)
-  {
-    if ((value & 0x1) == 1)
-    {
-      pinMapValue |= _data_pins[i];
-    }
-    value = (value >> 1);
-  }
+uint8_t LiquidCrystal_I2C::readStatus()
+{
+  return PCF8574Bus::readStatus();
+}
 
-  // Is it a command or data
-  // -----------------------
-  if (mode == LCD_DATA)
-  {
-    mode = _Rs;
-  }
+uint8_t LiquidCrystal_I2C::controllers()
+{
+  return PCF8574Bus::controllers();
+}
 
-  pinMapValue |= mode | _backlightStsMask;
-  pulseEnable(pinMapValue);
+void LiquidCrystal_I2C::selectController(uint8_t mask)
+{
+  PCF8574Bus::selectController(mask);
 }
 
-void LiquidCrystal_I2C::pulseEnable(uint8_t data)
+uint8_t LiquidCrystal_I2C::interleaveBytes()
 {
-  I2C_IO::write(data | _En); // En high
-  // delayMicroseconds(1);     // enable pulse must be >450ns
+  return PCF8574Bus::interleaveBytes();
+}
 
-  I2C_IO::write(data & ~_En); // En low
-  // delayMicroseconds(50);     // commands need > 37us to settle
+void LiquidCrystal_I2C::drainTransport()
+{
+  PCF8574Bus::drainTransport();
 }
 
-void LiquidCrystal_I2C::printstr(const char c[])
+#ifdef LCD_STATS
+void LiquidCrystal_I2C::transportStats(lcd_stats_t *stats)
 {
-  // This function is not identical to the function used for "real" I2C displays
-  // it's here so the user sketch doesn't have to be changed
-  print(c);
-}
\ No newline at end of file
+  PCF8574Bus::transportStats(stats);
+}
+
+void LiquidCrystal_I2C::resetTransportStats()
+{
+  PCF8574Bus::resetTransportStats();
+}
+#endif
@@ -0,0 +1,82 @@
+#include "LiquidCrystal_SPI.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+LiquidCrystal_SPI::LiquidCrystal_SPI(uint8_t latchPin, uint8_t lcd_cols, uint8_t lcd_rows)
+{
+  init(latchPin, lcd_cols, lcd_rows);
+}
+
+LiquidCrystal_SPI::LiquidCrystal_SPI(uint8_t latchPin, uint8_t lcd_cols, uint8_t lcd_rows,
+                                     uint8_t charsize, uint8_t En, uint8_t Rs,
+                                     uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                     uint8_t backlighPin, t_backlighPol pol)
+{
+  init(latchPin, lcd_cols, lcd_rows, charsize, En, Rs, d4, d5, d6, d7, backlighPin, pol);
+}
+
+uint8_t LiquidCrystal_SPI::init(uint8_t latchPin, uint8_t lcd_cols, uint8_t lcd_rows,
+                                uint8_t charsize, uint8_t En, uint8_t Rs,
+                                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                uint8_t backlighPin, t_backlighPol pol)
+{
+  _En = (1 << En);
+  _Rw = 0; // tied to ground
+  _Rs = (1 << Rs);
+  _polarity = pol;
+
+  HC595Bus::config(latchPin, En, Rs, d4, d5, d6, d7, backlighPin, pol);
+  return VirtLiquidCrystal::init(lcd_cols, lcd_rows, charsize);
+}
+
+void LiquidCrystal_SPI::setBacklightPin(uint8_t pin, t_backlighPol pol)
+{
+  _polarity = pol;
+  HC595Bus::setBacklightPin(pin, pol);
+}
+
+void LiquidCrystal_SPI::setBacklight(uint8_t value)
+{
+  HC595Bus::setBacklight(value);
+}
+
+/************ transport hooks **********/
+
+uint8_t LiquidCrystal_SPI::beginTransport()
+{
+  return HC595Bus::beginTransport();
+}
+
+uint8_t LiquidCrystal_SPI::bitMode()
+{
+  return HC595Bus::bitMode();
+}
+
+void LiquidCrystal_SPI::send(uint8_t value, uint8_t mode)
+{
+  HC595Bus::send(value, mode);
+}
+
+void LiquidCrystal_SPI::sendBuffer(const uint8_t *buffer, size_t size)
+{
+  HC595Bus::sendBuffer(buffer, size);
+}
+
+uint8_t LiquidCrystal_SPI::controllers()
+{
+  return HC595Bus::controllers();
+}
+
+void LiquidCrystal_SPI::selectController(uint8_t mask)
+{
+  HC595Bus::selectController(mask);
+}
+
+uint8_t LiquidCrystal_SPI::interleaveBytes()
+{
+  return HC595Bus::interleaveBytes();
+}
@@ -0,0 +1,38 @@
+#ifndef LiquidCrystal_SPI_h
+#define LiquidCrystal_SPI_h
+
+#include "VirtLiquidCrystal.h"
+#include "HC595Bus.h"
+
+#define LCD_DEFAULT_LATCH 10 // SS of the Uno, free when the LCD is the only SPI device
+
+class LiquidCrystal_SPI : public VirtLiquidCrystal, public HC595Bus
+{
+public:
+    LiquidCrystal_SPI(uint8_t latchPin = LCD_DEFAULT_LATCH, uint8_t lcd_cols = 16, uint8_t lcd_rows = 2);
+
+    LiquidCrystal_SPI(uint8_t latchPin, uint8_t lcd_cols, uint8_t lcd_rows,
+                      uint8_t charsize, uint8_t En = HC595_LCD_EN, uint8_t Rs = HC595_LCD_RS,
+                      uint8_t d4 = HC595_LCD_D4, uint8_t d5 = HC595_LCD_D5, uint8_t d6 = HC595_LCD_D6, uint8_t d7 = HC595_LCD_D7,
+                      uint8_t backlighPin = 0, t_backlighPol pol = POSITIVE);
+
+    uint8_t init(uint8_t latchPin = LCD_DEFAULT_LATCH, uint8_t lcd_cols = 16, uint8_t lcd_rows = 2,
+                 uint8_t charsize = LCD_5x8DOTS, uint8_t En = HC595_LCD_EN, uint8_t Rs = HC595_LCD_RS,
+                 uint8_t d4 = HC595_LCD_D4, uint8_t d5 = HC595_LCD_D5, uint8_t d6 = HC595_LCD_D6, uint8_t d7 = HC595_LCD_D7,
+                 uint8_t backlighPin = 0, t_backlighPol pol = POSITIVE);
+
+    void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE);
+    void setBacklight(uint8_t new_val);
+
+private:
+    // VirtTransport hooks, forwarded to the HC595Bus transport
+    uint8_t beginTransport();
+    uint8_t bitMode();
+    void send(uint8_t value, uint8_t mode);
+    void sendBuffer(const uint8_t *buffer, size_t size);
+    uint8_t controllers();
+    void selectController(uint8_t mask);
+    uint8_t interleaveBytes();
+};
+
+#endif // LiquidCrystal_SPI_h
@@ -0,0 +1,416 @@
+/**
+ * @file PCF8574Bus.h
+ * @brief Transport driving an HD44780 LCD in 4 bit mode through a PCF8574 I2C expander.
+ *
+ * Header only so that BasicLiquidCrystal<PCF8574Bus> resolves the transport at
+ * compile time. LiquidCrystal_I2C is the virtual adapter over it.
+ * With a 16 bit expander (setWideExpander()) the LCD runs in 8 bit mode.
+ * The frames can be queued for an interrupt or DMA driven I2C master instead of
+ * the Wire library, see I2C_IO::setBackend().
+ */
+
+#ifndef _PCF8574Bus_H_
+#define _PCF8574Bus_H_
+
+#include "BasicLiquidCrystal.h"
+#include "I2C_IO.h"
+
+#define LCD_EN 6  // Enable bit
+#define LCD_RW 5  // Read/Write bit
+#define LCD_RS 4  // Register select bit
+
+#define LCD_D4 0
+#define LCD_D5 1
+#define LCD_D6 2
+#define LCD_D7 3
+
+/** @brief Microseconds the HD44780 needs after most instructions */
+#define PCF8574_EXEC_TIME 37
+
+class PCF8574Bus : public I2C_IO
+{
+public:
+  /** @brief Set the expander address and the port bits the LCD is wired to */
+  void config(uint8_t i2cAddr, uint8_t En = LCD_EN, uint8_t Rw = LCD_RW, uint8_t Rs = LCD_RS,
+              uint8_t d4 = LCD_D4, uint8_t d5 = LCD_D5, uint8_t d6 = LCD_D6, uint8_t d7 = LCD_D7,
+              uint8_t backlighPin = 0, t_backlighPol pol = POSITIVE);
+
+  void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE);
+  void setBacklight(uint8_t value);
+  uint8_t getBacklight();
+
+  /** @brief Port bit of the second enable line of 40x4 displays (rows 2-3), call before begin()
+   *
+   *  All 8 port bits are usually taken, use the R/W one with R/W tied to ground.
+   */
+  void setEnable2Pin(uint8_t En2);
+
+  /** @brief Drive the LCD in 8 bit mode through a PCF8575 or MCP23017, call before begin()
+   *
+   *  LCD D0-D7 are on the first port (P00-P07, GPIOA). EN, R/W, RS and the backlight
+   *  are on the second port, at the bit numbers given to config(). Each character is
+   *  then one enable strobe instead of two nibbles.
+   *
+   *  @param chip I2C_IO_PCF8575 or I2C_IO_MCP23017
+   */
+  void setWideExpander(uint8_t chip);
+
+  /** @brief Run the bus at the fastest clock the wiring carries, call after begin()
+   *
+   *  I2C_IO::selfTest() on the LCD data lines with the enable line held low, so
+   *  the LCD ignores the patterns. The clock can also be set up front with
+   *  setClock(), begin() applies it. Neither goes above lcdMaxClock().
+   *
+   *  @param maxClock Fastest clock to try, Hz
+   *  @return The clock picked and the port updates per second it reaches, an
+   *  LCD character takes 4 of them in 4 bit mode and 2 in 8 bit mode
+   */
+  i2c_io_speed_t tuneClock(uint32_t maxClock = I2C_IO_MAX_CLOCK);
+
+  /** @brief Fastest clock the LCD keeps up with
+   *
+   *  Characters go back to back in a transaction, the first strobe of one comes
+   *  two port updates after the last strobe of the previous one. Those must
+   *  outlast the execution time: 480kHz with a PCF8574, 970kHz with a 16 bit
+   *  expander whose port updates are two bytes.
+   */
+  uint32_t lcdMaxClock();
+
+  /** @brief SCL frequency in Hz, clipped to lcdMaxClock() */
+  void setClock(uint32_t clock);
+
+  //& Transport interface used by BasicLiquidCrystal --------------------------------------------------------------------------
+
+  uint8_t beginTransport();
+  uint8_t bitMode() { return _bitmode; };
+  void send(uint8_t value, uint8_t mode);
+  void sendBuffer(const uint8_t *buffer, size_t size);
+  bool canReadStatus();
+  uint8_t readStatus();
+  void setStatusPolling(bool){}; // the port updates between two bytes outlast the execution time
+  uint8_t controllers() { return (_en2Mask != 0) ? 2 : 1; };
+  void selectController(uint8_t mask);
+  uint8_t interleaveBytes() { return 0; }; // the port updates between two bytes outlast the execution time
+  void drainTransport() { I2C_IO::drain(); };
+
+#ifdef LCD_STATS
+  void transportStats(lcd_stats_t *stats);
+  void resetTransportStats();
+#endif
+
+private:
+  uint8_t write4bits(uint8_t value, uint8_t mode, uint16_t *frames);
+  uint8_t write8bits(uint8_t value, uint8_t mode, uint16_t *frames);
+  uint8_t pulseEnable(uint16_t data, uint16_t *frames);
+  uint8_t ctrlShift() { return (_bitmode & LCD_8BIT_MODE) ? 8 : 0; };
+
+  uint8_t _bitmode; // LCD_4BIT_MODE, or LCD_8BIT_MODE on a 16 bit expander
+
+  uint16_t _enMask; // Enable IO pin mask
+  uint16_t _en2Mask; // Second controller enable IO pin mask, 0 if none
+  uint16_t _selectedEn; // Enable masks strobed
+  uint16_t _rwMask; // R/W IO pin mask
+  uint16_t _rsMask; // Register select IO pin mask
+
+  uint16_t _backlightPinMask; // Backlight IO pin mask
+  uint16_t _backlightStsMask; // Backlight status mask
+  t_backlighPol _backlightPol;
+
+  uint8_t _data_pins[4]; // LCD data lines
+};
+
+inline void PCF8574Bus::config(uint8_t i2cAddr, uint8_t En, uint8_t Rw, uint8_t Rs,
+                               uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                               uint8_t backlighPin, t_backlighPol pol)
+{
+  I2C_IO::init(i2cAddr);
+
+  _bitmode = LCD_4BIT_MODE;
+  _enMask = (1 << En);
+  _en2Mask = 0;
+  _selectedEn = _enMask;
+  _rwMask = (1 << Rw);
+  _rsMask = (1 << Rs);
+
+  // Initialise pin mapping
+  _data_pins[0] = (1 << d4);
+  _data_pins[1] = (1 << d5);
+  _data_pins[2] = (1 << d6);
+  _data_pins[3] = (1 << d7);
+
+  if (backlighPin)
+  {
+    setBacklightPin(backlighPin, pol);
+  }
+  else
+  {
+    _backlightPinMask = 0;
+    _backlightStsMask = LCD_NOBACKLIGHT;
+    _backlightPol = pol;
+  }
+}
+
+inline void PCF8574Bus::setBacklightPin(uint8_t pin, t_backlighPol pol)
+{
+
+  _backlightPinMask = ((uint16_t)1 << pin) << ctrlShift();
+  _backlightPol = pol;
+  setBacklight(0); // todo
+}
+
+inline void PCF8574Bus::setBacklight(uint8_t value)
+{
+  // Check if backlight is available
+  // ----------------------------------------------------
+  if (_backlightPinMask != 0x0)
+  {
+    // Check for polarity to configure mask accordingly
+    // ----------------------------------------------------------
+    if (((_backlightPol == POSITIVE) && (value > 0)) ||
+        ((_backlightPol == NEGATIVE) && (value == 0)))
+    {
+      _backlightStsMask = _backlightPinMask;
+    }
+    else
+    {
+      _backlightStsMask = LCD_NOBACKLIGHT;
+    }
+    I2C_IO::write16(_backlightStsMask);
+  }
+}
+
+inline uint8_t PCF8574Bus::getBacklight()
+{
+  return (uint8_t)(_backlightStsMask >> ctrlShift());
+}
+
+inline void PCF8574Bus::setEnable2Pin(uint8_t En2)
+{
+  _en2Mask = ((uint16_t)1 << En2) << ctrlShift();
+  if (_rwMask == _en2Mask)
+  {
+    _rwMask = 0;
+  }
+}
+
+// The control bits move to the second port, where they have a whole port to
+// themselves, and the first port becomes the 8 bit data bus
+inline void PCF8574Bus::setWideExpander(uint8_t chip)
+{
+  if (_bitmode & LCD_8BIT_MODE)
+  {
+    return;
+  }
+
+  I2C_IO::setChip(chip);
+  _bitmode = LCD_8BIT_MODE;
+  _enMask <<= 8;
+  _en2Mask <<= 8;
+  _selectedEn <<= 8;
+  _rwMask <<= 8;
+  _rsMask <<= 8;
+  _backlightPinMask <<= 8;
+  _backlightStsMask <<= 8;
+}
+
+// Rounded down to 10kHz so that the gap stays over the execution time once
+// the bus timing is rounded to whole microseconds
+inline uint32_t PCF8574Bus::lcdMaxClock()
+{
+  uint32_t bits = 2 * 9 * ((I2C_IO::width() > 8) ? 2 : 1); // 8 bits and the ACK per byte
+
+  return (bits * 1000000UL / PCF8574_EXEC_TIME) / 10000 * 10000;
+}
+
+inline void PCF8574Bus::setClock(uint32_t clock)
+{
+  I2C_IO::setClock((clock > lcdMaxClock()) ? lcdMaxClock() : clock);
+}
+
+inline i2c_io_speed_t PCF8574Bus::tuneClock(uint32_t maxClock)
+{
+  uint16_t dataMask = 0x00FF;
+
+  if (!(_bitmode & LCD_8BIT_MODE))
+  {
+    dataMask = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3];
+  }
+  return I2C_IO::selfTest(dataMask, (maxClock > lcdMaxClock()) ? lcdMaxClock() : maxClock);
+}
+
+inline void PCF8574Bus::selectController(uint8_t mask)
+{
+  _selectedEn = ((mask & LCD_CONTROLLER_1) ? _enMask : 0) | ((mask & LCD_CONTROLLER_2) ? _en2Mask : 0);
+}
+
+inline uint8_t PCF8574Bus::beginTransport()
+{
+  _selectedEn = _enMask;
+  return I2C_IO::begin();
+}
+
+/************ low level data pushing commands **********/
+
+// expanderWrite either command or data
+// Every EN high/low frame of the byte is collected first and then clocked out
+// in a single I2C transaction instead of one transaction per frame.
+inline void PCF8574Bus::send(uint8_t value, uint8_t mode)
+{
+  uint16_t frames[4];
+  uint8_t size;
+
+  if (_bitmode & LCD_8BIT_MODE)
+  {
+    size = write8bits(value, mode, frames);
+  }
+  else if (mode == FOUR_BITS)
+  {
+    size = write4bits((value & 0x0F), COMMAND, frames);
+  }
+  else
+  {
+    size = write4bits((value >> 4), mode, frames);
+    size += write4bits((value & 0x0F), mode, &frames[size]);
+  }
+
+  I2C_IO::write16(frames, size);
+}
+
+// Stream a run of data bytes, packing as many characters as the Wire buffer
+// holds into each transaction
+inline void PCF8574Bus::sendBuffer(const uint8_t *buffer, size_t size)
+{
+  uint16_t frames[I2C_IO_BUFFER_LENGTH];
+  uint8_t capacity = I2C_IO::framesPerWrite();
+  uint8_t perChar = (_bitmode & LCD_8BIT_MODE) ? 2 : 4;
+  uint8_t fill = 0;
+
+  for (size_t i = 0; i < size; i++)
+  {
+    if (fill + perChar > capacity)
+    {
+      I2C_IO::write16(frames, fill);
+      fill = 0;
+    }
+    if (_bitmode & LCD_8BIT_MODE)
+    {
+      fill += write8bits(buffer[i], LCD_DATA, &frames[fill]);
+    }
+    else
+    {
+      fill += write4bits((buffer[i] >> 4), LCD_DATA, &frames[fill]);
+      fill += write4bits((buffer[i] & 0x0F), LCD_DATA, &frames[fill]);
+    }
+  }
+
+  if (fill > 0)
+  {
+    I2C_IO::write16(frames, fill);
+  }
+}
+
+// Encode a nibble into its enable strobe frames, returns the number of frames
+inline uint8_t PCF8574Bus::write4bits(uint8_t value, uint8_t mode, uint16_t *frames)
+{
+  uint16_t pinMapValue = 0;
+
+  // Map the value to LCD pin mapping
+  // --------------------------------
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    if ((value & 0x1) == 1)
+    {
+      pinMapValue |= _data_pins[i];
+    }
+    value = (value >> 1);
+  }
+
+  // Is it a command or data
+  // -----------------------
+  if (mode == LCD_DATA)
+  {
+    pinMapValue |= _rsMask;
+  }
+
+  pinMapValue |= _backlightStsMask;
+  return pulseEnable(pinMapValue, frames);
+}
+
+// Encode a byte into its enable strobe frames, D0-D7 are the first port
+inline uint8_t PCF8574Bus::write8bits(uint8_t value, uint8_t mode, uint16_t *frames)
+{
+  uint16_t pinMapValue = value | _backlightStsMask;
+
+  if (mode == LCD_DATA)
+  {
+    pinMapValue |= _rsMask;
+  }
+  return pulseEnable(pinMapValue, frames);
+}
+
+inline uint8_t PCF8574Bus::pulseEnable(uint16_t data, uint16_t *frames)
+{
+  frames[0] = data | _selectedEn;  // En high
+  // enable pulse must be >450ns, one I2C byte at 100kHz already takes ~90us
+
+  frames[1] = data & ~_selectedEn; // En low
+  // commands need > 37us to settle, the two port updates before the next
+  // strobe take longer up to lcdMaxClock()
+  return 2;
+}
+
+// Not with two controllers, each has its own busy flag, nor in 8 bit mode
+inline bool PCF8574Bus::canReadStatus()
+{
+  return ((_rwMask != 0) && (_en2Mask == 0) && !(_bitmode & LCD_8BIT_MODE));
+}
+
+// Read the status register one nibble per enable pulse with the data lines
+// released (written high) so the LCD can drive them. RS and RW are set in a
+// port update of their own, for their setup time before En rises.
+// A status read is at least 8 transactions on the bus.
+inline uint8_t PCF8574Bus::readStatus()
+{
+  uint8_t dataMask = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3];
+  uint16_t frame = _rwMask | _backlightStsMask; // RS low selects the status register
+  uint8_t status = 0;
+
+  I2C_IO::maskMode(dataMask, INPUT);
+  I2C_IO::write16(frame); // RS low, RW high, En still low
+
+  for (uint8_t nibble = 0; nibble < 2; nibble++)
+  {
+    I2C_IO::write16(frame | _enMask); // En high
+    uint8_t port = I2C_IO::read();
+    I2C_IO::write16(frame);           // En low
+
+    status <<= 4;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      if (port & _data_pins[i])
+      {
+        status |= (1 << i);
+      }
+    }
+  }
+
+  I2C_IO::maskMode(dataMask, OUTPUT);
+  I2C_IO::write16(_backlightStsMask); // back to write mode, RW low
+
+  return status;
+}
+
+#ifdef LCD_STATS
+inline void PCF8574Bus::transportStats(lcd_stats_t *stats)
+{
+  stats->i2cTransactions = I2C_IO::transactions();
+  stats->i2cNacks = I2C_IO::nacks();
+}
+
+inline void PCF8574Bus::resetTransportStats()
+{
+  I2C_IO::resetCounters();
+}
+#endif
+
+#endif // _PCF8574Bus_H_
@@ -0,0 +1,608 @@
+/**
+ * @file ParallelBus.h
+ * @brief Transport driving an HD44780 LCD directly from MCU pins, 4 or 8 bit.
+ *
+ * Header only so that BasicLiquidCrystal<ParallelBus> inlines the pin writes.
+ * LiquidCrystal is the virtual adapter over it.
+ *
+ * Each strobe waits for what is left of the execution time of the controller it
+ * goes to, instead of a fixed delay after it, so 40x4 modules (two controllers on
+ * separate enable lines) can be fed one controller while the other executes.
+ * With busy flag polling on, it waits for the busy flag to clear instead.
+ */
+
+#ifndef _ParallelBus_H_
+#define _ParallelBus_H_
+
+#include "BasicLiquidCrystal.h"
+
+#define EXEC_TIME 37
+
+#ifndef UINT8_MAX
+#define UINT8_MAX 0xff // 255
+#endif // !UINT8_MAX
+
+class ParallelBus
+{
+public:
+  /** @brief Set the pins the LCD is wired to
+   *
+   *  @param bitmode LCD_4BIT_MODE (d0-d3 are the LCD D4-D7 lines) or LCD_8BIT_MODE
+   *  @param rs Register select pin
+   *  @param rw Read/write pin, UINT8_MAX if tied to ground
+   *  @param enable Enable pin
+   */
+  void config(uint8_t bitmode, uint8_t rs, uint8_t rw, uint8_t enable,
+              uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+              uint8_t d4 = 0, uint8_t d5 = 0, uint8_t d6 = 0, uint8_t d7 = 0,
+              uint8_t backlighPin = 0, t_backlighPol pol = POSITIVE);
+
+#if defined(ARDUINO_ARCH_ESP32)
+  void analogWrite(uint8_t channel, uint32_t value, uint32_t valueMax = UINT8_MAX);
+#endif
+  void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE);
+  void setBacklight(uint8_t value);
+
+  /** @brief Enable pin of the second controller of 40x4 displays (rows 2-3), call before begin() */
+  void setEnable2Pin(uint8_t enable2) { _enable2_pin = enable2; };
+
+  //& Transport interface used by BasicLiquidCrystal --------------------------------------------------------------------------
+
+  uint8_t beginTransport();
+  uint8_t bitMode() { return _bitmode; };
+  void send(uint8_t value, uint8_t mode);
+  void sendBuffer(const uint8_t *buffer, size_t size);
+  bool canReadStatus();
+  uint8_t readStatus();
+  void setStatusPolling(bool enable) { _statusPolling = enable; };
+  uint8_t controllers() { return (_enable2_pin != UINT8_MAX) ? 2 : 1; };
+  void selectController(uint8_t mask) { _selected = mask; };
+  uint8_t interleaveBytes() { return 1; };
+  void drainTransport(){};
+
+#ifdef LCD_STATS
+  void transportStats(lcd_stats_t *){};
+  void resetTransportStats(){};
+#endif
+
+private:
+  void write4bits(uint8_t value);
+  void writeNbits(uint8_t value, uint8_t numBits);
+  void setDataPins(uint8_t value, uint8_t numBits);
+  uint8_t readNbits(uint8_t numBits);
+
+  void pulseEnable();
+  void writeRs(uint8_t level);
+  void writeEn(uint8_t level);
+  bool pollReady();
+  void waitReady();
+  void strobed();
+
+  uint8_t _bitmode;
+  uint8_t _rs_pin;      // Register select pin
+  uint8_t _rw_pin;      // R/W pin, UINT8_MAX if not wired
+  uint8_t _enable_pin;  // Enable pin
+  uint8_t _enable2_pin; // Enable pin of the second controller, UINT8_MAX if none
+  uint8_t _selected;    // Controllers strobed, LCD_CONTROLLER_1 | LCD_CONTROLLER_2 bits
+  bool _statusPolling;  // Wait on the busy flag before each strobe
+  uint32_t _strobeAt[2]; // micros() of the last strobe of each controller
+  uint8_t _data_pins[8];
+  uint8_t _backlightPin;
+  t_backlighPol _backlightPol;
+
+#ifdef FAST_MODE
+  // Port registers resolved once in beginTransport(), see mapPorts()
+  void mapPorts();
+
+  volatile uint8_t *_rsPort;
+  uint8_t _rsMask;
+  volatile uint8_t *_enPort;
+  uint8_t _enMask;
+  volatile uint8_t *_en2Port;
+  uint8_t _en2Mask;
+
+  volatile uint8_t *_groupPort[8]; // Output register of each port used by the data pins
+  uint8_t _groupMask[8];           // Data pins on that port
+  uint8_t _groups;                 // Number of ports used by the data pins
+  uint8_t _dataGroup[8];           // Port group of each data pin
+  uint8_t _dataMask[8];            // Port bit of each data pin
+  uint8_t _dataShift;              // Port bit of d0 if all data pins are contiguous on one port, else 0xFF
+#endif
+};
+
+inline void ParallelBus::config(uint8_t bitmode, uint8_t rs, uint8_t rw, uint8_t enable,
+                                uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+                                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                uint8_t backlighPin, t_backlighPol pol)
+{
+    _bitmode = bitmode;
+    _rs_pin = rs;
+    _rw_pin = rw;
+    _enable_pin = enable;
+    _enable2_pin = UINT8_MAX;
+    _selected = LCD_CONTROLLER_1;
+    _statusPolling = false;
+
+    _data_pins[0] = d0;
+    _data_pins[1] = d1;
+    _data_pins[2] = d2;
+    _data_pins[3] = d3;
+    _data_pins[4] = d4;
+    _data_pins[5] = d5;
+    _data_pins[6] = d6;
+    _data_pins[7] = d7;
+
+    if (backlighPin)
+    {
+        setBacklightPin(backlighPin, pol);
+    }
+    else
+    {
+        _backlightPin = 0;
+        _backlightPol = pol;
+    }
+}
+
+inline void ParallelBus::setBacklightPin(uint8_t pin, t_backlighPol pol)
+{
+    pinMode(pin, OUTPUT); // Difine the backlight pin as output
+    _backlightPin = pin;
+    _backlightPol = pol;
+    setBacklight(LCD_NOBACKLIGHT); // Set the backlight low by default
+}
+
+// ESP32 complains if not included
+#if defined(ARDUINO_ARCH_ESP32)
+inline void ParallelBus::analogWrite(uint8_t channel, uint32_t value, uint32_t valueMax)
+{
+    // calculate duty, 8191 from 2 ^ 13 - 1
+    uint32_t duty = (8191 / valueMax) * min(value, valueMax);
+
+    // write duty to LEDC
+    ledcWrite(channel, duty);
+}
+#endif
+
+inline void ParallelBus::setBacklight(uint8_t value)
+{
+    // Check if there is a pin assigned to the backlight
+    // ---------------------------------------------------
+    if (_backlightPin != LCD_NOBACKLIGHT)
+    {
+
+#if digitalPinHasPWM
+        if (digitalPinHasPWM(_backlightPin))
+#elif digitalPinToTimer
+        // On older 1.x Arduino have to check using hack
+        if (digitalPinToTimer(_backlightPin) != NOT_ON_TIMER)
+#else
+        if (false) // if neither of the above we assume no PWM
+#endif
+        {
+            // Check for control polarity inversion
+            // ---------------------------------------------------
+            if (_backlightPol == POSITIVE)
+            {
+
+                analogWrite(_backlightPin, value);
+            }
+            else
+            {
+                analogWrite(_backlightPin, UINT8_MAX - value);
+            }
+        }
+        // Not a PWM pin, set the backlight pin for POSI or NEG
+        // polarity
+        // --------------------------------------------------------
+        else if (((value > 0) && (_backlightPol == POSITIVE)) ||
+                 ((value == 0) && (_backlightPol == NEGATIVE)))
+        {
+            digitalWrite(_backlightPin, HIGH);
+        }
+        else
+        {
+            digitalWrite(_backlightPin, LOW);
+        }
+    }
+}
+
+inline uint8_t ParallelBus::beginTransport()
+{
+    pinMode(_rs_pin, OUTPUT);
+    // we can save 1 pin by not using RW. Indicate by passing 255 instead of pin#
+    if (_rw_pin != UINT8_MAX)
+    {
+        pinMode(_rw_pin, OUTPUT);
+    }
+
+    pinMode(_enable_pin, OUTPUT);
+    if (_enable2_pin != UINT8_MAX)
+    {
+        pinMode(_enable2_pin, OUTPUT);
+        digitalWrite(_enable2_pin, LOW);
+    }
+
+    // Do these once, instead of every time a character is drawn for speed reasons.
+    for (int i = 0; i < ((_bitmode & LCD_8BIT_MODE) ? 8 : 4); ++i)
+    {
+        pinMode(_data_pins[i], OUTPUT);
+    }
+
+#ifdef FAST_MODE
+    mapPorts();
+#endif
+
+    // Now we pull both RS and R/W low to begin commands
+    digitalWrite(_rs_pin, LOW);
+    digitalWrite(_enable_pin, LOW);
+    if (_rw_pin != UINT8_MAX)
+    {
+        digitalWrite(_rw_pin, LOW);
+    }
+
+    _selected = LCD_CONTROLLER_1;
+    _strobeAt[0] = micros() - EXEC_TIME;
+    _strobeAt[1] = _strobeAt[0];
+
+    return true;
+}
+
+/************ low level data pushing commands **********/
+
+// write either command or data, with automatic 4/8-bit selection
+inline void ParallelBus::send(uint8_t value, uint8_t mode)
+{
+    pollReady();
+    writeRs(mode == LCD_DATA);
+
+    // if there is a RW pin indicated, set it low to Write
+    if (_rw_pin != UINT8_MAX)
+    {
+        digitalWrite(_rw_pin, LOW);
+    }
+
+    if (mode == FOUR_BITS)
+    {
+        setDataPins(value, 4); // init sequence, a single nibble
+    }
+    else if (_bitmode & LCD_8BIT_MODE)
+    {
+        setDataPins(value, 8);
+    }
+    else
+    {
+        setDataPins(value >> 4, 4);
+    }
+
+    waitReady();
+    pulseEnable();
+    if ((mode != FOUR_BITS) && !(_bitmode & LCD_8BIT_MODE))
+    {
+        write4bits(value);
+    }
+    strobed();
+}
+
+// Stream a run of data bytes. RS/RW are set once for the whole run and
+// each byte only waits for whatever is left of the previous byte's execution
+// time once its first nibble is already on the data pins.
+inline void ParallelBus::sendBuffer(const uint8_t *buffer, size_t size)
+{
+    writeRs(HIGH);
+    if (_rw_pin != UINT8_MAX)
+    {
+        digitalWrite(_rw_pin, LOW);
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t value = buffer[i];
+
+        if (pollReady())
+        {
+            writeRs(HIGH); // the status read left RS low
+        }
+        if (_bitmode & LCD_8BIT_MODE)
+        {
+            setDataPins(value, 8);
+        }
+        else
+        {
+            setDataPins(value >> 4, 4);
+        }
+
+        waitReady();
+        pulseEnable();
+
+        if (!(_bitmode & LCD_8BIT_MODE))
+        {
+            write4bits(value);
+        }
+        strobed();
+    }
+}
+
+// Wait on the busy flag, before the pins are set up for the write since reading
+// the status turns the data lines around. Like the delays, the execution time
+// still bounds the wait if the flag reads busy forever. Returns true if it
+// read the status.
+inline bool ParallelBus::pollReady()
+{
+    if (!_statusPolling)
+    {
+        return false;
+    }
+
+    while (((micros() - _strobeAt[0]) < EXEC_TIME) && (readStatus() & LCD_BUSY_FLAG))
+    {
+    }
+    _strobeAt[0] = micros() - EXEC_TIME; // waitReady() has nothing left to wait
+    return true;
+}
+
+// Wait until every selected controller is done with its last instruction
+inline void ParallelBus::waitReady()
+{
+    uint32_t now = micros();
+    uint32_t wait = 0;
+
+    for (uint8_t c = 0; c < 2; c++)
+    {
+        uint32_t elapsed = now - _strobeAt[c];
+
+        if ((_selected & (1 << c)) && (elapsed < EXEC_TIME) && (EXEC_TIME - elapsed > wait))
+        {
+            wait = EXEC_TIME - elapsed;
+        }
+    }
+    if (wait)
+    {
+        delayMicroseconds(wait);
+    }
+}
+
+inline void ParallelBus::strobed()
+{
+    uint32_t now = micros();
+
+    for (uint8_t c = 0; c < 2; c++)
+    {
+        if (_selected & (1 << c))
+        {
+            _strobeAt[c] = now;
+        }
+    }
+}
+
+inline void ParallelBus::pulseEnable(void)
+{
+    // There is no need for the delays, since the digitalWrite operation
+    // takes longer.
+
+    // digitalWrite(_En, LOW);
+    // delayMicroseconds(1);
+    writeEn(HIGH);
+    delayMicroseconds(1); // enable pulse must be >450ns
+    writeEn(LOW);
+    // delayMicroseconds(100); // commands need > 37us to settle
+}
+
+inline void ParallelBus::write4bits(uint8_t value)
+{
+    writeNbits(value, 4);
+}
+
+inline void ParallelBus::writeNbits(uint8_t value, uint8_t numBits)
+{
+    setDataPins(value, numBits);
+    pulseEnable();
+}
+
+inline void ParallelBus::setDataPins(uint8_t value, uint8_t numBits)
+{
+#ifdef FAST_MODE
+    uint8_t oldSREG = SREG;
+
+    cli(); // other pins of the ports may be changed from interrupts
+    if (_dataShift != 0xFF)
+    {
+        // All data pins in order on one port, a single store
+        uint8_t mask = (uint8_t)(((1 << numBits) - 1) << _dataShift);
+        *_groupPort[0] = (*_groupPort[0] & ~mask) | ((uint8_t)(value << _dataShift) & mask);
+    }
+    else
+    {
+        // One store per port used by the data pins
+        uint8_t bits[8] = {0};
+
+        for (uint8_t i = 0; i < numBits; i++)
+        {
+            if ((value >> i) & 0x01)
+            {
+                bits[_dataGroup[i]] |= _dataMask[i];
+            }
+        }
+        for (uint8_t g = 0; g < _groups; g++)
+        {
+            *_groupPort[g] = (*_groupPort[g] & ~_groupMask[g]) | bits[g];
+        }
+    }
+    SREG = oldSREG;
+#else
+    for (uint8_t i = 0; i < numBits; i++)
+    {
+        digitalWrite(_data_pins[i], (value >> i) & LCD_ENTRY_SHIFT_INCREMENT);
+    }
+#endif
+}
+
+inline void ParallelBus::writeRs(uint8_t level)
+{
+#ifdef FAST_MODE
+    uint8_t oldSREG = SREG;
+
+    cli();
+    if (level)
+    {
+        *_rsPort |= _rsMask;
+    }
+    else
+    {
+        *_rsPort &= ~_rsMask;
+    }
+    SREG = oldSREG;
+#else
+    digitalWrite(_rs_pin, level);
+#endif
+}
+
+inline void ParallelBus::writeEn(uint8_t level)
+{
+#ifdef FAST_MODE
+    uint8_t oldSREG = SREG;
+
+    cli();
+    if (level)
+    {
+        if (_selected & LCD_CONTROLLER_1)
+        {
+            *_enPort |= _enMask;
+        }
+        if (_selected & LCD_CONTROLLER_2)
+        {
+            *_en2Port |= _en2Mask;
+        }
+    }
+    else
+    {
+        *_enPort &= ~_enMask;
+        *_en2Port &= ~_en2Mask;
+    }
+    SREG = oldSREG;
+#else
+    if (_selected & LCD_CONTROLLER_1)
+    {
+        digitalWrite(_enable_pin, level);
+    }
+    if ((_selected & LCD_CONTROLLER_2) && (_enable2_pin != UINT8_MAX))
+    {
+        digitalWrite(_enable2_pin, level);
+    }
+#endif
+}
+
+#ifdef FAST_MODE
+// Resolve the output register and bit of every pin once, instead of the
+// pin to port lookups digitalWrite() does on each call.
+// Note: unlike digitalWrite() this doesn't turn off PWM on the pins.
+inline void ParallelBus::mapPorts()
+{
+    uint8_t numBits = (_bitmode & LCD_8BIT_MODE) ? 8 : 4;
+
+    _rsPort = portOutputRegister(digitalPinToPort(_rs_pin));
+    _rsMask = digitalPinToBitMask(_rs_pin);
+    _enPort = portOutputRegister(digitalPinToPort(_enable_pin));
+    _enMask = digitalPinToBitMask(_enable_pin);
+    _en2Port = _enPort; // no second controller: a zero mask on a valid register
+    _en2Mask = 0;
+    if (_enable2_pin != UINT8_MAX)
+    {
+        _en2Port = portOutputRegister(digitalPinToPort(_enable2_pin));
+        _en2Mask = digitalPinToBitMask(_enable2_pin);
+    }
+
+    _groups = 0;
+    for (uint8_t i = 0; i < numBits; i++)
+    {
+        volatile uint8_t *port = portOutputRegister(digitalPinToPort(_data_pins[i]));
+        uint8_t g = 0;
+
+        while ((g < _groups) && (_groupPort[g] != port))
+        {
+            g++;
+        }
+        if (g == _groups)
+        {
+            _groupPort[g] = port;
+            _groupMask[g] = 0;
+            _groups++;
+        }
+
+        _dataGroup[i] = g;
+        _dataMask[i] = digitalPinToBitMask(_data_pins[i]);
+        _groupMask[g] |= _dataMask[i];
+    }
+
+    // Contiguous data pins, d0 on the lowest bit, allow a shifted single store
+    _dataShift = 0xFF;
+    if (_groups == 1)
+    {
+        uint8_t shift = 0;
+
+        while (!(_dataMask[0] & (1 << shift)))
+        {
+            shift++;
+        }
+        _dataShift = shift;
+        for (uint8_t i = 1; i < numBits; i++)
+        {
+            if ((shift + i > 7) || (_dataMask[i] != (1 << (shift + i))))
+            {
+                _dataShift = 0xFF;
+                break;
+            }
+        }
+    }
+}
+#endif
+
+inline uint8_t ParallelBus::readNbits(uint8_t numBits)
+{
+    uint8_t value = 0;
+
+    writeEn(HIGH);
+    delayMicroseconds(1); // data is valid 360ns after enable rises
+    for (uint8_t i = 0; i < numBits; i++)
+    {
+        value |= (digitalRead(_data_pins[i]) << i);
+    }
+    writeEn(LOW);
+    delayMicroseconds(1); // enable cycle must be >1us
+
+    return value;
+}
+
+// Not with two controllers, each has its own busy flag
+inline bool ParallelBus::canReadStatus()
+{
+    return ((_rw_pin != UINT8_MAX) && (_enable2_pin == UINT8_MAX));
+}
+
+inline uint8_t ParallelBus::readStatus()
+{
+    uint8_t numBits = (_bitmode & LCD_8BIT_MODE) ? 8 : 4;
+    uint8_t status;
+
+    for (uint8_t i = 0; i < numBits; i++)
+    {
+        pinMode(_data_pins[i], INPUT);
+    }
+    writeRs(LOW);
+    digitalWrite(_rw_pin, HIGH);
+
+    status = readNbits(numBits);
+    if (numBits == 4)
+    {
+        status = (status << 4) | readNbits(4);
+    }
+
+    digitalWrite(_rw_pin, LOW);
+    for (uint8_t i = 0; i < numBits; i++)
+    {
+        pinMode(_data_pins[i], OUTPUT);
+    }
+
+    return status;
+}
+
+#endif // _ParallelBus_H_
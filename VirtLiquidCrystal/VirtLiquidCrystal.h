@@ -7,273 +7,88 @@
 #ifndef _VirtLiquidCrystal_H_
 #define _VirtLiquidCrystal_H_
 
-#if (ARDUINO < 100)
-#include <WProgram.h>
-#else
-#include <Arduino.h>
-#endif
-
-#ifdef __AVR__
-#include <avr/pgmspace.h>
-#endif
-
-#include <inttypes.h>
-#include <Print.h>
-
-
-#ifdef __AVR__
-#define FAST_MODE
-#endif
-
-/** @defgroup LCD_Commands
- *  @brief LCD command definitions shouldn't be used unless you are writing a driver.
- *  @note All these definitions are for driver implementation only and shouldn't be used by applications.
- */
-#define LCD_CLEAR_DISPLAY 0x01   //& (1<<0)
-#define LCD_RETURN_HOME 0x02     //& (1<<1)
-#define LCD_ENTRY_MODE_SET 0x04  //& (1<<2)
-#define LCD_DISPLAY_CONTROL 0x08 //& (1<<3)
-#define LCD_CURSOR_SHIFT 0x10    //& (1<<4)
-#define LCD_FUNCTION_SET 0x20    //& (1<<5)
-#define LCD_SET_CGRAM_ADDR 0x40  //& (1<<6)
-#define LCD_SET_DDRAM_ADDR 0x80  //& (1<<7)
+#include "BasicLiquidCrystal.h"
 
-/** @defgroup flags for display entry mode
- *  Flags for setting the text entry mode
+/** @brief Transport with virtual hooks, implemented by the LCD drivers
+ *  @note Only drivers override these, applications use the VirtLiquidCrystal API.
  */
-#define LCD_ENTRY_RIGHT 0x00
-#define LCD_ENTRY_LEFT 0x02
-#define LCD_ENTRY_SHIFT_INCREMENT 0x01 
-#define LCD_ENTRY_SHIFT_DECREMENT 0x00 
-
-/** @defgroup flags for display on/off and blink control
- *  Flags for turning the display on/off and controlling the blink and cursor
- */
-#define LCD_DISPLAY_ON 0x04   //& 
-#define LCD_DISPLAY_OFF 0x00  
-#define LCD_CURSOR_ON 0x02 //& 
-#define LCD_CURSOR_OFF 0x00
-#define LCD_BLINK_ON 0x01 //& 
-#define LCD_BLINK_OFF 0x00
-
-/** @defgroup flags for display/cursor shift
- *  Flags for shifting the display or cursor
- */
-#define LCD_DISPLAY_MOVE 0x08  //& 
-#define LCD_CURSOR_MOVE 0x00   //& 
-#define LCD_MOVE_RIGHT 0x04  //& 
-#define LCD_MOVE_LEFT 0x00  //& 
-
-/** @defgroup flags for function set
- *  Flags for setting the function of the display
- */
-#define LCD_8BIT_MODE 0x10  //& 
-#define LCD_4BIT_MODE 0x00  //& 
-#define LCD_2_LINE 0x08     //& 
-#define LCD_1_LINE 0x00     //& 
-#define LCD_5x10DOTS 0x04   //& 
-#define LCD_5x8DOTS 0x00    //& 
-
-/** @defgroup flags for backlight control
- *  Flags for controlling the backlight of the display
- */
-#define LCD_BACKLIGHT_ON 0x08
-#define LCD_BACKLIGHT_OFF 0x00 
-// flags for backlight control
-#define LCD_NOBACKLIGHT 0x00
-#define LCD_BACKLIGHT 0xFF //
-
-/** @defgroup Define COMMAND and LCD_DATA LCD Rs (used by send method).
- *  Constants for distinguishing between commands and data sent to the LCD
- */
-#define COMMAND 0
-#define LCD_DATA 1
-#define FOUR_BITS 2
-
-#define HOME_CLEAR_EXEC 2000
-
-typedef enum
-{
-  POSITIVE,
-  NEGATIVE
-} t_backlighPol;
-
-typedef enum
-{
-  DISPLAY_ON,
-  DISPLAY_OFF,
-  CURSOR_ON,
-  CURSOR_OFF,
-  BLINK_ON,
-  BLINK_OFF,
-  SCROLL_LEFT,
-  SCROLL_RIGHT,
-  LEFT_TO_RIGHT,
-  RIGHT_TO_LEFT,
-  AUTOSCROLL_ON,
-  AUTOSCROLL_OFF,
-  BACKLIGHT_ON,
-  BACKLIGHT_OFF,
-} lcd_mode_t;
-
-class VirtLiquidCrystal : public Print
+class VirtTransport
 {
 public:
-  uint8_t init(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
-
-  void begin();
-
-  /** @brief Clear the display */
-  void clear();
-
-  /** @brief Move the cursor to the home position */
-  void home();
-
-  /** @brief Turn off the display */
-  void noDisplay();
-
-  /** @brief Turn on the display */
-  void display();
-
-  /**
-   * @brief set display modes
-   *
-   * @param mode
-   * - DISPLAY_ON Turn the display on
-   * - DISPLAY_OFF Turn the display off
-   * - CURSOR_ON Turns the underline cursor on
-   * - CURSOR_OFF Turns the underline cursor off
-   * - BLINK_ON Turn the blinking cursor on
-   * - BLINK_OFF Turn the blinking cursor off
-   * - SCROLL_LEFT These command scroll the display without changing the RAM
-   * - SCROLL_RIGHT These commands scroll the display without changing the RAM
-   * - LEFT_TO_RIGHT This is for text that flows Left to Right
-   * - RIGHT_TO_LEFT This is for text that flows Right to Left
-   * - AUTOSCROLL_ON This will 'right justify' text from the cursor
-   * - AUTOSCROLL_OFF This will 'left justify' text from the cursor
-   *
-   */
-  void display(lcd_mode_t mode);
-
-  /** @brief Turn off the blink */
-  void noBlink();
-
-  /** @brief Turn on the blink */
-  void blink();
-
-  /** @brief Turn off the cursor */
-  void noCursor();
-
-  /** @brief Turn on the cursor */
-  void cursor();
-
-  /** @brief Scroll the display left */
-  void scrollDisplayLeft(); 
-
-  /** @brief Scroll the display right */
-  void scrollDisplayRight(); 
-
-  /** @brief Set the text direction to left-to-right */
-  void leftToRight();
-
-  /** @brief Set the text direction to right-to-left */
-  void rightToLeft();
-
-  void moveCursorRight();
-  void moveCursorLeft();
-
-  /** @brief Turn on autoscrolling */
-  void autoscroll();
-
-  /** @brief Turn off autoscrolling */
-  void noAutoscroll();
-
-  /** @brief Create a custom character
-   *
-   *  @param location Location of the custom character
-   *  @param charmap Character map for the custom character
-   */
-  void createChar(uint8_t location, uint8_t charmap[]);
-
-#ifdef __AVR__
-  void createChar(uint8_t location, const char *charmap);
-#endif // __AVR__
-
-  /** @brief Set the cursor position
-   *
-   *  @param col Column position of the cursor
-   *  @param row Row position of the cursor
-   */
-  void setCursor(uint8_t col, uint8_t row);
-
-  /** @brief Turn on the backlight */
-  void backlight(void);
-
-  /** @brief Turn off the backlight */
-  void noBacklight(void);
-
-  /** @brief Turn on the display */
-  void on(void);
-
-  /** @brief Turn off the display */
-  void off(void);
-
-  void waitMicroseconds(uint8_t cmdDelay);
-  //& Virtual class methods --------------------------------------------------------------------------
-
-  
 #if (ARDUINO < 100)
-  virtual void write(uint8_t value);
   virtual void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE){};
   virtual void setBacklight(uint8_t new_val){};
 #else
-  virtual size_t write(uint8_t value);
   virtual void setBacklightPin(uint8_t pin, t_backlighPol pol = POSITIVE) = 0;
   virtual void setBacklight(uint8_t new_val) = 0;
 #endif
-  using Print::write;
 
-  //   //& Internal LCD variables to control the LCD shared between all derived classes. --------------------------------------------------------------------------
+protected:
+  /** @brief Set up the bus, return false if the LCD can't be reached */
+  virtual uint8_t beginTransport() { return true; };
+
+  /** @brief Interface length the driver is wired for, LCD_4BIT_MODE or LCD_8BIT_MODE */
+  virtual uint8_t bitMode() { return LCD_4BIT_MODE; };
+
+#if (ARDUINO < 100)
+  virtual void send(uint8_t value, uint8_t mode){};
+#else
+  virtual void send(uint8_t value, uint8_t mode) = 0;
+#endif
+
+  /** @brief Send a run of data bytes to the LCD
+   *
+   *  Drivers override this to stream the whole run with as little per-byte
+   *  bus overhead as the interface allows. Default sends byte by byte.
+   *
+   *  @param buffer Data bytes to send
+   *  @param size Number of bytes in buffer
+   */
+  virtual void sendBuffer(const uint8_t *buffer, size_t size);
 
-  uint8_t _displayfunction; // LCD_5x10DOTS or LCD_5x8DOTS, LCD_4BIT_MODE or LCD_8BIT_MODE, LCD_1_LINE or LCD_2_LINE
-  uint8_t _displaycontrol;  // LCD base control command LCD on/off, blink, cursor all commands are "ored" to its contents.
-  uint8_t _displaymode;     // Text entry mode to the LCD
+  /** @brief Check if the driver has the R/W line to read the status register */
+  virtual bool canReadStatus() { return false; };
 
-  uint8_t _charsize;
-  uint8_t _rows;
-  uint8_t _cols;
+  /** @brief Read the status register, busy flag and address counter */
+  virtual uint8_t readStatus() { return LCD_BUSY_FLAG; };
 
-  t_backlighPol _polarity;
-  uint8_t _backlightValue;
-  // uint8_t _backlightPin;
+  /** @brief Wait on the busy flag instead of the execution time before each strobe */
+  virtual void setStatusPolling(bool){};
 
-  uint8_t _En; //_enable_pin // 
-  uint8_t _Rw; // _rw_pin // R/W pin
-  uint8_t _Rs; // _rs_pin//  Register Select pin
+  /** @brief Number of HD44780 on the display, 2 for 40x4 modules with two enable lines */
+  virtual uint8_t controllers() { return 1; };
 
-protected:
-  uint8_t _initialized;
+  /** @brief Enable line(s) the next sends strobe, LCD_CONTROLLER_1, LCD_CONTROLLER_2 or both */
+  virtual void selectController(uint8_t){};
 
-  //& PRIVATE--------------------------------------------------------------------------
+  /** @brief Bytes sent to one controller before switching to the other, 0 for whole runs */
+  virtual uint8_t interleaveBytes() { return 0; };
 
-private:
-  /** @brief Send a command to the LCD
-   *
-   *  @param value Value of the command to send
-   */
-  void command(uint8_t value);
+  /** @brief Wait until everything sent has reached the LCD, for buses that queue transfers */
+  virtual void drainTransport(){};
 
-#if (ARDUINO < 100)
-  virtual void send(uint8_t value, uint8_t mode){};
-  virtual void pulseEnable(void){};
-#else
-  virtual void send(uint8_t value, uint8_t mode) = 0;
-  virtual void pulseEnable(void) = 0;
+#ifdef LCD_STATS
+  /** @brief Add the counters kept by the bus, I2C ones */
+  virtual void transportStats(lcd_stats_t *){};
+  virtual void resetTransportStats(){};
 #endif
 };
 
+/** @brief Base virtual class for LiquidCrystal and LiquidCrystal_I2C
+ *
+ *  Runtime polymorphic version of BasicLiquidCrystal, for code (menu systems...)
+ *  that handles displays of different types through one interface.
+ */
+class VirtLiquidCrystal : public BasicLiquidCrystal<VirtTransport>
+{
+};
+
+// The virtual version is compiled once, in VirtLiquidCrystal.cpp
+extern template class BasicLiquidCrystal<VirtTransport>;
+
 #endif // _VirtLiquidCrystal_H_
 
+
 #if 0
 //& compatibility API function aliases --------------------------------------------------------------------------
 
@@ -0,0 +1,394 @@
+/**
+ * @file lcd_bench.cpp
+ * @brief Host benchmark of the LCD drivers against the simulated Arduino core.
+ *
+ * For each driver and API call prints the I2C transactions, bytes on the wire
+ * (address bytes included), GPIO toggles (the SPI latch pulses among them), time spent waiting in delay() and
+ * delayMicroseconds(), and the total simulated time of the call, I2C transfers
+ * at 100kHz included.
+ * A second table compares BENCH_DISPLAYS I2C displays on one bus updated one
+ * after the other with the same updates interleaved by LCDScheduler.
+ * A third one shows the clock tuneClock() settles on as the wiring limit goes up,
+ * and the writes a redraw at that clock loses on a HostBackpack model of the LCD.
+ * Another one times a redraw over I2C blocking in Wire against the same redraw
+ * queued for an asynchronous backend: the time the caller is held and the time
+ * until the last transaction has left the bus.
+ * The last one runs a sensor loop printing a value every millisecond for a
+ * simulated second, straight to the LCD and through refresh() at a few frame
+ * rates: frames sent, I2C transactions and the time the loop spent in LCD calls.
+ * The output is deterministic, diff it against a previous release to catch
+ * regressions. The emulator and HostBackpack runs also check what the LCD shows
+ * after a redraw, and that no write reached it while busy; the exit status is 1
+ * if one of these checks failed.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=10819 -Iextras/host -IVirtLiquidCrystal -o lcd_bench \
+ *       extras/bench/lcd_bench.cpp extras/host/Arduino.cpp VirtLiquidCrystal/[A-Z]*.cpp
+ *   ./lcd_bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include "HostCounters.h"
+
+#include "HD44780Emulator.h"
+#include "HostBackpack.h"
+#include "HostI2CBackend.h"
+#include "LCDScheduler.h"
+#include "LiquidCrystal.h"
+#include "LiquidCrystal_I2C.h"
+#include "LiquidCrystal_SPI.h"
+
+#define BENCH_COLS 20
+#define BENCH_ROWS 4
+#define BENCH_DISPLAYS 6
+#define BENCH_TRANSFERS 8
+#define BENCH_LOOP_US 1000   // Sensor loop period
+#define BENCH_LOOP_TIME 1000000
+
+typedef struct
+{
+  const char *name;
+  void (*setup)(VirtLiquidCrystal &lcd); // Not measured, may be NULL
+  void (*run)(VirtLiquidCrystal &lcd);
+} bench_op_t;
+
+static uint8_t framebuffer[LCD_FRAMEBUFFER_SIZE(BENCH_COLS, BENCH_ROWS)];
+
+static uint8_t glyph[8] = {0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00};
+static uint8_t glyphs[LCD_CGRAM_SLOTS][8];
+
+static unsigned long failures; // Failed screen and overrun checks
+
+static void printChars(VirtLiquidCrystal &lcd, uint8_t count)
+{
+   char text[BENCH_COLS + 1];
+
+   for (uint8_t i = 0; i < count; i++)
+   {
+      text[i] = 'A' + (i % 26);
+   }
+   text[count] = '\0';
+   lcd.print(text);
+}
+
+// Compare a row shown after redraw() with what it prints
+static void checkRedrawRow(const char *driver, uint8_t row, const char *shown)
+{
+   char expected[BENCH_COLS + 1];
+
+   for (uint8_t i = 0; i < BENCH_COLS; i++)
+   {
+      expected[i] = 'A' + (i % 26);
+   }
+   expected[BENCH_COLS] = '\0';
+   if (strcmp(shown, expected) != 0)
+   {
+      printf("%-12s row %u shows \"%s\", expected \"%s\"\n", driver, row, shown, expected);
+      failures++;
+   }
+}
+
+static void checkOverruns(const char *driver, const char *call, uint32_t overruns)
+{
+   if (overruns != 0)
+   {
+      printf("%-12s %-16s lost %lu writes\n", driver, call, (unsigned long)overruns);
+      failures++;
+   }
+}
+
+static void print1(VirtLiquidCrystal &lcd) { printChars(lcd, 1); }
+static void print8(VirtLiquidCrystal &lcd) { printChars(lcd, 8); }
+static void print20(VirtLiquidCrystal &lcd) { printChars(lcd, 20); }
+static void setCursor(VirtLiquidCrystal &lcd) { lcd.setCursor(5, 2); }
+static void clear(VirtLiquidCrystal &lcd) { lcd.clear(); }
+static void home(VirtLiquidCrystal &lcd) { lcd.home(); }
+static void cursorOn(VirtLiquidCrystal &lcd) { lcd.cursor(); }
+static void createChar(VirtLiquidCrystal &lcd) { lcd.createChar(3, glyph); }
+static void createChars(VirtLiquidCrystal &lcd) { lcd.createChars(0, glyphs, LCD_CGRAM_SLOTS); }
+
+static void redraw(VirtLiquidCrystal &lcd)
+{
+   for (uint8_t row = 0; row < BENCH_ROWS; row++)
+   {
+      lcd.setCursor(0, row);
+      printChars(lcd, BENCH_COLS);
+   }
+}
+
+// Same screen as redraw() with a 4 digit value changed, through the framebuffer
+static void drawFramebuffer(VirtLiquidCrystal &lcd)
+{
+   lcd.setFramebuffer(framebuffer);
+   redraw(lcd);
+   lcd.flush();
+
+   lcd.setCursor(8, 1);
+   lcd.print("1234");
+}
+
+static void flush(VirtLiquidCrystal &lcd) { lcd.flush(); }
+
+static const bench_op_t ops[] = {
+    {"print 1 char", NULL, print1},
+    {"print 8 chars", NULL, print8},
+    {"print 20 chars", NULL, print20},
+    {"setCursor", NULL, setCursor},
+    {"clear", NULL, clear},
+    {"home", NULL, home},
+    {"cursor", NULL, cursorOn},
+    {"cursor again", cursorOn, cursorOn},
+    {"createChar", NULL, createChar},
+    {"createChars 8", NULL, createChars},
+    {"redraw 20x4", NULL, redraw},
+    {"flush 4 cells", drawFramebuffer, flush},
+};
+
+// model, if not NULL, is lcd and gets its screen and overruns checked
+static void bench(const char *driver, VirtLiquidCrystal &lcd, HD44780Emulator *model = NULL)
+{
+   for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+   {
+      lcd.setFramebuffer(NULL);
+      lcd.begin();
+      uint32_t overruns = (model != NULL) ? model->controller().overruns() : 0;
+      if (ops[i].setup != NULL)
+      {
+         ops[i].setup(lcd);
+      }
+
+      hostResetCounters();
+      unsigned long start = micros();
+      ops[i].run(lcd);
+      unsigned long elapsed = micros() - start;
+
+      printf("%-12s %-16s %8lu %8lu %8lu %10lu %10lu\n", driver, ops[i].name,
+             (unsigned long)hostCounters.i2cTransactions, (unsigned long)hostCounters.i2cBytes,
+             (unsigned long)hostCounters.gpioToggles, (unsigned long)hostCounters.waitMicros,
+             elapsed);
+
+      if (model != NULL)
+      {
+         checkOverruns(driver, ops[i].name, model->controller().overruns() - overruns);
+      }
+      if ((model != NULL) && (ops[i].run == redraw))
+      {
+         char shown[BENCH_COLS + 1];
+
+         for (uint8_t row = 0; row < BENCH_ROWS; row++)
+         {
+            model->readRow(row, shown);
+            checkRedrawRow(driver, row, shown);
+         }
+      }
+   }
+}
+
+// clear() and 8 characters on every display, fits the asynchronous queue
+static void update(LiquidCrystal_I2C *lcds)
+{
+   for (uint8_t i = 0; i < BENCH_DISPLAYS; i++)
+   {
+      lcds[i].clear();
+      printChars(lcds[i], 8);
+   }
+}
+
+static void benchScheduler()
+{
+   LiquidCrystal_I2C lcds[BENCH_DISPLAYS];
+   LCDScheduler scheduler;
+
+   for (uint8_t i = 0; i < BENCH_DISPLAYS; i++)
+   {
+      lcds[i].init(0x20 + i, BENCH_COLS, BENCH_ROWS);
+      lcds[i].begin();
+   }
+
+   hostResetCounters();
+   unsigned long start = micros();
+   update(lcds);
+   printf("%-29s %8lu %10lu\n", "blocking", (unsigned long)hostCounters.i2cTransactions,
+          micros() - start);
+
+   for (uint8_t i = 0; i < BENCH_DISPLAYS; i++)
+   {
+      scheduler.add(lcds[i]);
+   }
+   hostResetCounters();
+   start = micros();
+   update(lcds);
+   scheduler.flush();
+   printf("%-29s %8lu %10lu\n", "LCDScheduler", (unsigned long)hostCounters.i2cTransactions,
+          micros() - start);
+}
+
+// Wiring limits the simulated bus is given, 0 for none
+static const uint32_t wiringLimits[] = {100000, 400000, 800000, 0};
+
+static void benchClock(const char *name, uint8_t chip)
+{
+   HostBackpack backpack(LCD_DEFAULT_ADDR, chip);
+   LiquidCrystal_I2C lcd(LCD_DEFAULT_ADDR, BENCH_COLS, BENCH_ROWS);
+
+   if (chip != I2C_IO_PCF8574)
+   {
+      lcd.setWideExpander(chip);
+   }
+   lcd.begin();
+   for (size_t i = 0; i < sizeof(wiringLimits) / sizeof(wiringLimits[0]); i++)
+   {
+      Wire.setMaxClock(wiringLimits[i]);
+      i2c_io_speed_t speed = lcd.tuneClock();
+      char limit[16] = "none";
+
+      uint32_t overruns = backpack.overruns();
+      redraw(lcd);
+      overruns = backpack.overruns() - overruns;
+
+      if (wiringLimits[i] != 0)
+      {
+         snprintf(limit, sizeof(limit), "%lu", (unsigned long)wiringLimits[i]);
+      }
+      printf("%-12s %-12s %12lu %8lu %8lu\n", name, limit, (unsigned long)speed.clock,
+             (unsigned long)speed.framesPerSecond, (unsigned long)overruns);
+      checkOverruns(name, limit, overruns);
+
+      for (uint8_t row = 0; row < BENCH_ROWS; row++)
+      {
+         char shown[BENCH_COLS + 1];
+
+         backpack.readRow(row, BENCH_COLS, shown);
+         checkRedrawRow(name, row, shown);
+      }
+   }
+   Wire.setMaxClock(0);
+   Wire.setClock(100000);
+}
+
+static void benchAsync()
+{
+   LiquidCrystal_I2C lcd(LCD_DEFAULT_ADDR, BENCH_COLS, BENCH_ROWS);
+   HostI2CBackend backend;
+   i2c_io_transfer_t transfers[BENCH_TRANSFERS];
+
+   lcd.begin();
+   hostResetCounters();
+   unsigned long start = micros();
+   redraw(lcd);
+   unsigned long elapsed = micros() - start;
+   printf("%-29s %8lu %10lu %10lu\n", "blocking", (unsigned long)hostCounters.i2cTransactions,
+          elapsed, elapsed);
+
+   lcd.setBackend(&backend, transfers, BENCH_TRANSFERS);
+   hostResetCounters();
+   start = micros();
+   redraw(lcd);
+   elapsed = micros() - start;
+   lcd.drain();
+   printf("%-29s %8lu %10lu %10lu\n", "HostI2CBackend", (unsigned long)hostCounters.i2cTransactions,
+          elapsed, micros() - start);
+}
+
+// Frame rates refresh() is capped at, 0 for uncapped
+static const uint8_t frameRates[] = {0, 50, 10};
+
+// Prints the loop count at the same place every BENCH_LOOP_US, fps < 0 writes
+// straight to the LCD. Time not spent on the bus is spent in delay()
+static void sensorLoop(const char *name, VirtLiquidCrystal &lcd, int fps)
+{
+   unsigned long frames = 0;
+   unsigned long busy = 0;
+
+   lcd.setFramebuffer((fps < 0) ? NULL : framebuffer);
+   lcd.begin();
+   if (fps >= 0)
+   {
+      lcd.setMaxFps(fps);
+   }
+   hostResetCounters();
+
+   unsigned long start = micros();
+   for (uint32_t i = 0; (micros() - start) < BENCH_LOOP_TIME; i++)
+   {
+      unsigned long at = micros();
+
+      lcd.setCursor(8, 1);
+      lcd.print(i % 10000);
+      if ((fps < 0) || lcd.refresh())
+      {
+         frames++;
+      }
+
+      unsigned long elapsed = micros() - at;
+      busy += elapsed;
+      if (elapsed < BENCH_LOOP_US)
+      {
+         delayMicroseconds(BENCH_LOOP_US - elapsed);
+      }
+   }
+   printf("%-29s %8lu %8lu %10lu\n", name, frames, (unsigned long)hostCounters.i2cTransactions, busy);
+   lcd.setFramebuffer(NULL);
+}
+
+static void benchRefresh()
+{
+   LiquidCrystal_I2C lcd(LCD_DEFAULT_ADDR, BENCH_COLS, BENCH_ROWS);
+
+   sensorLoop("direct", lcd, -1);
+   for (size_t i = 0; i < sizeof(frameRates) / sizeof(frameRates[0]); i++)
+   {
+      char name[32] = "refresh, no cap";
+
+      if (frameRates[i] != 0)
+      {
+         snprintf(name, sizeof(name), "refresh, %u fps", frameRates[i]);
+      }
+      sensorLoop(name, lcd, frameRates[i]);
+   }
+}
+
+int main()
+{
+   HD44780Emulator emulator(BENCH_COLS, BENCH_ROWS);
+   LiquidCrystal parallel4(BENCH_COLS, BENCH_ROWS, LCD_5x8DOTS, LCD_4BIT_MODE,
+                           12, UINT8_MAX, 11, 5, 4, 3, 2);
+   LiquidCrystal parallel8(BENCH_COLS, BENCH_ROWS, LCD_5x8DOTS, LCD_8BIT_MODE,
+                           12, UINT8_MAX, 11, 2, 3, 4, 5, 6, 7, 8, 9);
+   LiquidCrystal_I2C i2c(LCD_DEFAULT_ADDR, BENCH_COLS, BENCH_ROWS);
+   LiquidCrystal_I2C pcf8575(0x20, BENCH_COLS, BENCH_ROWS);
+   LiquidCrystal_I2C mcp23017(0x21, BENCH_COLS, BENCH_ROWS);
+   LiquidCrystal_SPI spi(LCD_DEFAULT_LATCH, BENCH_COLS, BENCH_ROWS);
+
+   pcf8575.setWideExpander(I2C_IO_PCF8575);
+   mcp23017.setWideExpander(I2C_IO_MCP23017);
+
+   printf("%-12s %-16s %8s %8s %8s %10s %10s\n", "driver", "call",
+          "i2c tx", "i2c B", "gpio", "wait us", "total us");
+
+   bench("emulator", emulator, &emulator);
+   bench("parallel 4b", parallel4);
+   bench("parallel 8b", parallel8);
+   bench("i2c pcf8574", i2c);
+   bench("i2c pcf8575", pcf8575);
+   bench("i2c mcp23017", mcp23017);
+   bench("spi 74hc595", spi);
+
+   printf("\n%d x i2c pcf8574, clear + 8 chars %8s %10s\n", BENCH_DISPLAYS, "i2c tx", "total us");
+   benchScheduler();
+
+   printf("\n%-12s %-12s %12s %8s %8s\n", "expander", "wiring max", "tuneClock Hz", "frames/s", "overruns");
+   benchClock("pcf8574", I2C_IO_PCF8574);
+   benchClock("pcf8575", I2C_IO_PCF8575);
+
+   printf("\n%-29s %8s %10s %10s\n", "i2c pcf8574, redraw 20x4", "i2c tx", "caller us", "total us");
+   benchAsync();
+
+   printf("\n%-29s %8s %8s %10s\n", "i2c pcf8574, 1s sensor loop", "frames", "i2c tx", "lcd us");
+   benchRefresh();
+
+   return (failures != 0) ? 1 : 0;
+}
@@ -0,0 +1,495 @@
+/**
+ * @file lcd_test.cpp
+ * @brief Host checks of what the LCD shows, against the HD44780 models.
+ *
+ * Each case drives a display through one of the library paths and compares
+ * the rendered rows with what it should show. It also checks that the controller
+ * models didn't drop a write for being busy. HD44780Emulator covers the
+ * driver logic, and HostBackpack covers the I2C timing at the clock tuneClock()
+ * picks.
+ * Prints one line per case, the exit status is the number of failed cases.
+ *
+ * Build and run from the repository root:
+ *   g++ -DARDUINO=10819 -Iextras/host -IVirtLiquidCrystal -o lcd_test \
+ *       extras/bench/lcd_test.cpp extras/host/Arduino.cpp VirtLiquidCrystal/[A-Z]*.cpp
+ *   ./lcd_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "HD44780Emulator.h"
+#include "HostBackpack.h"
+#include "LiquidCrystal_I2C.h"
+
+#define TEST_GLYPHS 10
+
+static uint8_t buffer[LCD_DOUBLE_BUFFER_SIZE(40, 4)];
+
+static uint8_t glyphs[TEST_GLYPHS][8];
+
+static bool failed; // The current case failed a check
+
+static void fail(const char *what, const char *expected, const char *shown)
+{
+   printf("  %s: expected \"%s\", shown \"%s\"\n", what, expected, shown);
+   failed = true;
+}
+
+// Compare a displayed row with text, padded with spaces to the row length
+static void expectRow(HD44780Emulator &lcd, uint8_t row, const char *text)
+{
+   char shown[41];
+   char expected[41];
+   uint8_t cols = strlen(text);
+
+   lcd.readRow(row, shown);
+   memset(expected, ' ', sizeof(expected));
+   memcpy(expected, text, cols);
+   expected[strlen(shown)] = '\0';
+
+   if (strcmp(shown, expected) != 0)
+   {
+      char what[16];
+
+      snprintf(what, sizeof(what), "row %u", row);
+      fail(what, expected, shown);
+   }
+}
+
+static void expectNoOverruns(HD44780 &lcd)
+{
+   if (lcd.overruns() != 0)
+   {
+      printf("  %lu writes lost to a busy controller\n", (unsigned long)lcd.overruns());
+      failed = true;
+   }
+}
+
+static void expectRows(HD44780Emulator &lcd, const char *const *rows, uint8_t count)
+{
+   for (uint8_t row = 0; row < count; row++)
+   {
+      expectRow(lcd, row, rows[row]);
+   }
+   expectNoOverruns(lcd.controller(0));
+   expectNoOverruns(lcd.controller(1));
+}
+
+static void printRows(VirtLiquidCrystal &lcd, const char *const *rows, uint8_t count)
+{
+   for (uint8_t row = 0; row < count; row++)
+   {
+      lcd.setCursor(0, row);
+      lcd.print(rows[row]);
+   }
+}
+
+//& Cases --------------------------------------------------------------------------
+
+// Only the changed run goes out, the rest stays as first flushed
+static void framebufferFlush()
+{
+   static const char *const first[] = {"Temperature", "Humidity", "Pressure", "Wind"};
+   static const char *const second[] = {"Temperature 21.5C", "Humidity", "Pressure", "Wind"};
+   HD44780Emulator lcd(20, 4);
+
+   lcd.begin();
+   lcd.setFramebuffer(buffer);
+   printRows(lcd, first, 4);
+   expectRow(lcd, 0, ""); // nothing sent before flush()
+   lcd.flush();
+   expectRows(lcd, first, 4);
+
+   uint32_t executed = lcd.controller().executed();
+   lcd.setCursor(12, 0);
+   lcd.print("21.5C");
+   lcd.flush();
+   expectRows(lcd, second, 4);
+   if (lcd.controller().executed() - executed != 6)
+   {
+      printf("  %lu writes for a 5 cell run, expected 6\n",
+             (unsigned long)(lcd.controller().executed() - executed));
+      failed = true;
+   }
+   lcd.setFramebuffer(NULL);
+}
+
+// setCursor() where the address counter already is costs nothing, neither
+// does creating no characters
+static void addressElision()
+{
+   static const char *const rows[] = {"ABCD", "  EF"};
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.setCursor(0, 0);
+   lcd.print("AB");
+
+   uint32_t executed = lcd.controller().executed();
+   lcd.createChars(0, glyphs, 0);
+   if (lcd.controller().executed() != executed)
+   {
+      printf("  createChars() of no character sent a command\n");
+      failed = true;
+   }
+
+   executed = lcd.controller().executed();
+   lcd.setCursor(2, 0);
+   lcd.print("CD");
+   if (lcd.controller().executed() - executed != 2)
+   {
+      printf("  setCursor() to the next cell sent a command\n");
+      failed = true;
+   }
+
+   lcd.setCursor(2, 1);
+   lcd.print("EF");
+   expectRows(lcd, rows, 2);
+}
+
+// Columns 8-15 of a 16x1 panel are on the second controller line, the address
+// jumps there. setCursor() handles it, and flush() for text written across it.
+static void split16x1()
+{
+   static const char *const rows[] = {"0123456789ABCDEF"};
+   static const char *const flushed[] = {"      6789abcdef"};
+   HD44780Emulator lcd(16, 1);
+
+   lcd.begin();
+   lcd.print("01234567");
+   lcd.setCursor(8, 0);
+   lcd.print("89ABCDEF");
+   expectRows(lcd, rows, 1);
+
+   lcd.setFramebuffer(buffer); // starts blank
+   lcd.setCursor(6, 0);
+   lcd.print("6789abcdef");
+   lcd.flush();
+   expectRows(lcd, flushed, 1);
+   lcd.setFramebuffer(NULL);
+}
+
+// Every layout of the init() geometry table, against the emulator's own panel wiring
+static void geometries()
+{
+   static const uint8_t sizes[][2] = {{8, 1}, {16, 1}, {16, 2}, {16, 4}, {20, 2},
+                                      {20, 4}, {24, 2}, {40, 2}, {40, 4}};
+
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      HD44780Emulator lcd(sizes[i][0], sizes[i][1]);
+      char rows[4][41];
+      const char *texts[4];
+
+      lcd.begin();
+      for (uint8_t row = 0; row < sizes[i][1]; row++)
+      {
+         for (uint8_t col = 0; col < sizes[i][0]; col++)
+         {
+            rows[row][col] = 'a' + row * 7 + (col % 7);
+         }
+         rows[row][sizes[i][0]] = '\0';
+         texts[row] = rows[row];
+      }
+
+      // A cell at a time, then whole rows
+      for (uint8_t row = 0; row < sizes[i][1]; row++)
+      {
+         for (uint8_t col = 0; col < sizes[i][0]; col++)
+         {
+            lcd.setCursor(col, row);
+            lcd.write(rows[row][col]);
+         }
+      }
+      expectRows(lcd, texts, sizes[i][1]);
+
+      lcd.clear();
+      printRows(lcd, texts, sizes[i][1]);
+      if ((sizes[i][0] == 16) && (sizes[i][1] == 1))
+      {
+         lcd.setCursor(8, 0); // the address jumps at the split
+         lcd.print(&rows[0][8]);
+      }
+      expectRows(lcd, texts, sizes[i][1]);
+      if (failed)
+      {
+         printf("  on a %ux%u display\n", sizes[i][0], sizes[i][1]);
+         return;
+      }
+   }
+}
+
+// Rows 2-3 of a 40x4 display are on the second controller
+static void dualController()
+{
+   static const char *const rows[] = {"Row 0, first controller",
+                                      "Row 1, first controller",
+                                      "Row 2, second controller",
+                                      "Row 3, second controller, up to the 40th"};
+   static const char *const changed[] = {"Row 0, first controller",
+                                         "Row 1, first controller",
+                                         "Row 2, changed",
+                                         "Row 3, second controller, up to the 40th"};
+   HD44780Emulator lcd(40, 4);
+
+   lcd.begin();
+   printRows(lcd, rows, 4);
+   expectRows(lcd, rows, 4);
+
+   lcd.clear();
+   lcd.setFramebuffer(buffer);
+   printRows(lcd, rows, 4);
+   lcd.setCursor(7, 2);
+   lcd.print("changed           ");
+   lcd.flush();
+   expectRows(lcd, changed, 4);
+   lcd.setFramebuffer(NULL);
+}
+
+static bool slotHolds(HD44780 &lcd, uint8_t slot, const uint8_t *rows)
+{
+   for (uint8_t i = 0; i < 8; i++)
+   {
+      if (lcd.cgram(slot * 8 + i) != rows[i])
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+// Without a framebuffer too, write(glyph(id)) right after setCursor(). The
+// driver doesn't know what is on screen then, cells of an evicted glyph show
+// the one that took its slot.
+static void glyphCache()
+{
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.setGlyphs(glyphs, TEST_GLYPHS);
+   lcd.print("glyphs");
+
+   for (uint8_t id = 0; id < TEST_GLYPHS; id++)
+   {
+      lcd.setCursor(6 + id, 1);
+      lcd.write(lcd.glyph(id));
+   }
+
+   // The last ones written are all loaded, in the slots their cells show,
+   // the first ones were evicted for them, least recently used first
+   for (uint8_t id = 0; id < TEST_GLYPHS; id++)
+   {
+      uint8_t slot = lcd.charAt(6 + id, 1);
+      uint8_t shows = (id < TEST_GLYPHS - LCD_CGRAM_SLOTS) ? id + LCD_CGRAM_SLOTS : id;
+
+      if ((slot >= LCD_CGRAM_SLOTS) || !slotHolds(lcd.controller(), slot, glyphs[shows]))
+      {
+         printf("  glyph %u: cell shows %u, not the bitmap of glyph %u\n", id, slot, shows);
+         failed = true;
+      }
+   }
+   expectRow(lcd, 0, "glyphs");
+   expectNoOverruns(lcd.controller());
+}
+
+// A glyph unused since before the use counter wrapped is still the oldest
+static void glyphTickWrap()
+{
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.setGlyphs(glyphs, TEST_GLYPHS);
+   uint8_t stale = lcd.glyph(0);
+   for (uint8_t id = 1; id < LCD_CGRAM_SLOTS; id++)
+   {
+      lcd.glyph(id);
+   }
+
+   // Lands the next miss just past the wrap, where the stale slot would look
+   // younger than the others
+   for (uint32_t i = 0; i < 65531UL; i++)
+   {
+      lcd.glyph(1 + i % (LCD_CGRAM_SLOTS - 1));
+   }
+
+   uint8_t slot = lcd.glyph(LCD_CGRAM_SLOTS);
+   if (slot != stale)
+   {
+      printf("  evicted slot %u, the stale one is %u\n", slot, stale);
+      failed = true;
+   }
+   expectNoOverruns(lcd.controller());
+}
+
+// flush() only ever shows whole published frames
+static void doubleBuffer()
+{
+   static const char *const first[] = {"Frame 1", "drawn"};
+   static const char *const second[] = {"Frame 2", "drawn"};
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.setDoubleBuffer(buffer);
+   printRows(lcd, first, 2);
+   lcd.swapBuffers();
+   lcd.flush();
+   expectRows(lcd, first, 2);
+
+   lcd.setCursor(6, 0);
+   lcd.print('2');
+   lcd.flush(); // not published yet
+   expectRows(lcd, first, 2);
+
+   lcd.swapBuffers();
+   lcd.flush();
+   expectRows(lcd, second, 2);
+   lcd.setFramebuffer(NULL);
+}
+
+// flush() streams left to right but leaves the drawing direction alone
+static void rightToLeftFlush()
+{
+   static const char *const rows[] = {"     hello world", ""};
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.setFramebuffer(buffer);
+   lcd.rightToLeft();
+   lcd.setCursor(9, 0);
+   lcd.print("olleh");
+   lcd.flush();
+   lcd.setCursor(15, 0);
+   lcd.print("dlrow");
+   lcd.flush();
+   expectRows(lcd, rows, 2);
+   if (lcd.controller().entryMode() & LCD_ENTRY_LEFT)
+   {
+      printf("  entry mode left to right after flush()\n");
+      failed = true;
+   }
+   lcd.leftToRight();
+   lcd.setFramebuffer(NULL);
+}
+
+// Queued operations go out as poll() finds the LCD ready
+static void asyncQueue()
+{
+   static const char *const rows[] = {"Queued", "  after clear"};
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.print("Old text");
+   lcd.setAsync(true);
+   lcd.clear();
+   printRows(lcd, rows, 2);
+   while (lcd.poll())
+   {
+   }
+   lcd.setAsync(false);
+   expectRows(lcd, rows, 2);
+}
+
+// A controller reset puts it back in 8 bit mode with the display off and empty
+static void resyncAfterReset()
+{
+   static const char *const rows[] = {"after", ""};
+   static const char *const redrawn[] = {"Framebuffer", "redrawn"};
+   HD44780Emulator lcd(16, 2);
+
+   lcd.begin();
+   lcd.print("before");
+   lcd.controller().reset();
+   delay(HD44780_POWER_ON_RESET / 1000 + 1);
+   lcd.resync();
+   lcd.clear();
+   lcd.print("after");
+   expectRows(lcd, rows, 2);
+   if (!(lcd.controller().displayControl() & LCD_DISPLAY_ON))
+   {
+      printf("  display still off\n");
+      failed = true;
+   }
+
+   lcd.setFramebuffer(buffer);
+   printRows(lcd, redrawn, 2);
+   lcd.flush();
+   lcd.controller().reset();
+   delay(HD44780_POWER_ON_RESET / 1000 + 1);
+   lcd.resync();
+   lcd.flush(); // everything again
+   expectRows(lcd, redrawn, 2);
+   lcd.setFramebuffer(NULL);
+}
+
+// Characters back to back over I2C at the clock tuneClock() settles on
+static void i2cTunedClock()
+{
+   static const char *const rows[] = {"Back to back", "characters over I2C", "at the tuned clock", "0123456789abcdefghij"};
+   HostBackpack backpack(LCD_DEFAULT_ADDR);
+   LiquidCrystal_I2C lcd(LCD_DEFAULT_ADDR, 20, 4);
+
+   lcd.begin();
+   lcd.tuneClock();
+   printRows(lcd, rows, 4);
+
+   for (uint8_t row = 0; row < 4; row++)
+   {
+      char shown[21];
+      char expected[21];
+
+      backpack.readRow(row, 20, shown);
+      snprintf(expected, sizeof(expected), "%-20s", rows[row]);
+      if (strcmp(shown, expected) != 0)
+      {
+         fail("row", expected, shown);
+      }
+   }
+   expectNoOverruns(backpack.controller());
+   Wire.setClock(100000);
+}
+
+typedef struct
+{
+  const char *name;
+  void (*run)();
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {"framebuffer flush", framebufferFlush},
+    {"address elision", addressElision},
+    {"16x1 split", split16x1},
+    {"40x4 dual controller", dualController},
+    {"geometries", geometries},
+    {"glyph cache", glyphCache},
+    {"glyph use counter wrap", glyphTickWrap},
+    {"double buffer", doubleBuffer},
+    {"right to left flush", rightToLeftFlush},
+    {"async queue", asyncQueue},
+    {"resync after reset", resyncAfterReset},
+    {"i2c tuned clock", i2cTunedClock},
+};
+
+int main()
+{
+   int failures = 0;
+
+   for (uint8_t id = 0; id < TEST_GLYPHS; id++)
+   {
+      for (uint8_t i = 0; i < 8; i++)
+      {
+         glyphs[id][i] = (id + i * 3) & 0x1F;
+      }
+   }
+
+   for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+   {
+      failed = false;
+      cases[i].run();
+      printf("%-24s %s\n", cases[i].name, failed ? "FAIL" : "ok");
+      failures += failed ? 1 : 0;
+   }
+   return failures;
+}
@@ -0,0 +1,276 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "SPI.h"
+#include "HostCounters.h"
+
+static unsigned long _micros = 0; // Simulated time
+static uint8_t _pinLevel[256];   // Last level written to each pin
+
+host_counters_t hostCounters;
+
+void hostResetCounters()
+{
+   memset(&hostCounters, 0, sizeof(hostCounters));
+}
+
+// ---------------------------------------------------------------------------
+// Time
+// ---------------------------------------------------------------------------
+unsigned long micros(void)
+{
+   return _micros++;
+}
+
+unsigned long millis(void)
+{
+   return (_micros / 1000);
+}
+
+void delay(unsigned long ms)
+{
+   _micros += ms * 1000;
+   hostCounters.waitMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+   _micros += us;
+   hostCounters.waitMicros += us;
+}
+
+// ---------------------------------------------------------------------------
+// Pins
+// ---------------------------------------------------------------------------
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+   hostCounters.gpioWrites++;
+   if (_pinLevel[pin] != val)
+   {
+      _pinLevel[pin] = val;
+      hostCounters.gpioToggles++;
+   }
+}
+
+int digitalRead(uint8_t)
+{
+   return LOW;
+}
+
+void analogWrite(uint8_t, int)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Print
+// ---------------------------------------------------------------------------
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+   size_t n = 0;
+   while (size--)
+   {
+      n += write(*buffer++);
+   }
+   return n;
+}
+
+size_t Print::print(long n, int base)
+{
+   if ((n < 0) && (base == DEC))
+   {
+      return print('-') + print((unsigned long)-n, base);
+   }
+   return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+   char buf[8 * sizeof(long) + 1];
+   char *str = &buf[sizeof(buf) - 1];
+
+   if (base < 2)
+   {
+      base = DEC;
+   }
+
+   *str = '\0';
+   do
+   {
+      char c = n % base;
+      n /= base;
+      *--str = (c < 10) ? (c + '0') : (c + 'A' - 10);
+   } while (n);
+
+   return write(str);
+}
+
+// ---------------------------------------------------------------------------
+// Wire
+// ---------------------------------------------------------------------------
+TwoWire Wire;
+
+// Bus time of a transfer, 9 clocks per byte (8 bits and the ACK) plus start and stop
+static unsigned long transferMicros(uint32_t clock, uint8_t bytes)
+{
+   return ((9UL * bytes + 2) * 1000000UL + clock - 1) / clock;
+}
+
+TwoWire::TwoWire() : _address(0), _txLength(0), _rxLength(0), _rxIndex(0), _rxPairs(false),
+                     _clock(100000), _maxClock(0), _monitor(NULL), _monitorContext(NULL)
+{
+   memset(_echo, 0xFF, sizeof(_echo)); // PCF857x pins come up high
+}
+
+uint32_t TwoWire::busMicros(uint8_t bytes)
+{
+   return transferMicros(_clock, bytes);
+}
+
+void TwoWire::begin()
+{
+   _txLength = 0;
+   _rxLength = 0;
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+   _clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+   _address = address;
+   _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+   if (_txLength >= BUFFER_LENGTH)
+   {
+      return 0;
+   }
+   _txBuffer[_txLength++] = value;
+   return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t size)
+{
+   size_t n = 0;
+   while ((n < size) && write(data[n]))
+   {
+      n++;
+   }
+   return n;
+}
+
+void TwoWire::setMonitor(host_wire_monitor_t monitor, void *context)
+{
+   _monitor = monitor;
+   _monitorContext = context;
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+   unsigned long start = _micros;
+
+   hostCounters.i2cTransactions++;
+   hostCounters.i2cBytes += 1 + _txLength;
+   if (overclocked())
+   {
+      _micros += transferMicros(_clock, 1 + _txLength);
+      _txLength = 0;
+      return 3; // data not acknowledged
+   }
+
+   // The start condition and the address byte, then each byte up to its ACK
+   for (uint8_t i = 0; (_monitor != NULL) && (i < _txLength); i++)
+   {
+      _micros = start + (9UL * (i + 2) + 1) * 1000000UL / _clock;
+      _monitor(_monitorContext, _address, i, _txBuffer[i]);
+   }
+   if (_micros < start + transferMicros(_clock, 1 + _txLength))
+   {
+      _micros = start + transferMicros(_clock, 1 + _txLength);
+   }
+
+   for (uint8_t i = 0; i < _txLength; i++)
+   {
+      _echo[_address & 0x7F] = (_echo[_address & 0x7F] >> 8) | (_txBuffer[i] << 8);
+   }
+   _txLength = 0;
+   return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+   _address = address;
+   _rxLength = (quantity > BUFFER_LENGTH) ? BUFFER_LENGTH : quantity;
+   _rxIndex = 0;
+   _rxPairs = !(quantity & 0x01);
+   hostCounters.i2cTransactions++;
+   hostCounters.i2cBytes += 1 + _rxLength;
+   _micros += transferMicros(_clock, 1 + _rxLength);
+   if (overclocked())
+   {
+      _rxLength = 0;
+   }
+   return _rxLength;
+}
+
+int TwoWire::available()
+{
+   return _rxLength;
+}
+
+int TwoWire::read()
+{
+   if (_rxLength == 0)
+   {
+      return -1;
+   }
+   _rxLength--;
+
+   uint16_t echo = _echo[_address & 0x7F];
+   return (_rxPairs && !(_rxIndex++ & 0x01)) ? (echo & 0xFF) : (echo >> 8);
+}
+
+// ---------------------------------------------------------------------------
+// SPI
+// ---------------------------------------------------------------------------
+SPIClass SPI;
+
+void SPIClass::begin()
+{
+}
+
+void SPIClass::end()
+{
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+   _clock = settings._clock;
+}
+
+void SPIClass::endTransaction()
+{
+}
+
+uint8_t SPIClass::transfer(uint8_t)
+{
+   transfer(NULL, 1);
+   return 0xFF;
+}
+
+void SPIClass::transfer(void *buffer, size_t size)
+{
+   hostCounters.spiBytes += size;
+   _micros += (8UL * size * 1000000UL + _clock - 1) / _clock;
+   if (buffer != NULL)
+   {
+      memset(buffer, 0xFF, size);
+   }
+}
@@ -0,0 +1,43 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for building the LCD library on a host.
+ *
+ * Time is simulated: delay() and delayMicroseconds() advance a microsecond
+ * clock instead of sleeping, so a host run reports how long each LCD call
+ * would hold a sketch. Pins and the Wire and SPI buses are inert.
+ *
+ * Build with ARDUINO set, the library headers test it before including this:
+ *   g++ -DARDUINO=10819 -Iextras/host -IVirtLiquidCrystal ...
+ */
+
+#ifndef _HostArduino_H_
+#define _HostArduino_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Print.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+/** @brief Simulated clock, every call costs a microsecond so polling loops make progress */
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+#endif // _HostArduino_H_
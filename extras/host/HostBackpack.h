@@ -0,0 +1,109 @@
+/**
+ * @file HostBackpack.h
+ * @brief Host model of an I2C LCD backpack, an expander on the Wire stub driving an HD44780 model.
+ *
+ * It watches what is written to its address (TwoWire::setMonitor()) and strobes
+ * the controller model on each enable falling edge, at the simulated time the
+ * expander updates its pins. A driver feeding the LCD faster than it executes
+ * then shows up in overruns(), which HD44780Emulator can't show since its bus
+ * time is a setting.
+ * Wired like PCF8574Bus by default: D4-D7 on P0-P3, RS on P4, R/W on P5 and EN on
+ * P6. With a PCF8575 D0-D7 are on the first port and the control lines on the
+ * second, at the same bit numbers.
+ */
+
+#ifndef _HostBackpack_H_
+#define _HostBackpack_H_
+
+#include "Wire.h"
+#include "HD44780Emulator.h"
+#include "PCF8574Bus.h"
+
+class HostBackpack
+{
+public:
+  /** @brief Backpack at address, listening on Wire until destroyed
+   *
+   *  @param chip I2C_IO_PCF8574 or I2C_IO_PCF8575
+   */
+  HostBackpack(uint8_t address, uint8_t chip = I2C_IO_PCF8574)
+      : _address(address), _wide(chip == I2C_IO_PCF8575), _ctrl(0), _low(0)
+  {
+    Wire.setMonitor(monitor, this);
+  };
+
+  ~HostBackpack() { Wire.setMonitor(NULL); };
+
+  HD44780 &controller() { return _lcd; };
+
+  /** @brief Writes dropped because the LCD was still busy */
+  uint32_t overruns() { return _lcd.overruns(); };
+
+  /** @brief Copy a displayed row into buffer, NUL terminated (cols + 1 bytes)
+   *
+   *  Rows start at 0x00, 0x40, cols and 0x40 + cols like most modules.
+   */
+  void readRow(uint8_t row, uint8_t cols, char *buffer)
+  {
+    uint8_t offset = ((row & 0x01) ? 0x40 : 0x00) + ((row & 0x02) ? cols : 0);
+
+    for (uint8_t col = 0; col < cols; col++)
+    {
+      buffer[col] = (char)_lcd.charAt(offset + col);
+    }
+    buffer[cols] = '\0';
+  };
+
+private:
+  static void monitor(void *context, uint8_t address, uint8_t index, uint8_t value)
+  {
+    HostBackpack *backpack = (HostBackpack *)context;
+
+    if (address != backpack->_address)
+    {
+      return;
+    }
+    if (!backpack->_wide)
+    {
+      backpack->update(value);
+    }
+    else if (!(index & 0x01))
+    {
+      backpack->_low = value; // the second port follows
+    }
+    else
+    {
+      backpack->update(backpack->_low | (value << 8));
+    }
+  };
+
+  // The controller latches on the enable falling edge, R/W high reads instead
+  void update(uint16_t port)
+  {
+    uint8_t ctrl = _wide ? (port >> 8) : port;
+    uint8_t data = _wide ? (port & 0xFF) : ((port & 0x0F) << 4);
+    bool fell = (_ctrl & (1 << LCD_EN)) && !(ctrl & (1 << LCD_EN));
+
+    _ctrl = ctrl;
+    if (!fell)
+    {
+      return;
+    }
+    if (ctrl & (1 << LCD_RW))
+    {
+      _lcd.read(ctrl & (1 << LCD_RS));
+    }
+    else
+    {
+      _lcd.strobe(data, ctrl & (1 << LCD_RS));
+    }
+  };
+
+  HD44780 _lcd;
+  uint8_t _address;
+  bool _wide;     // PCF8575, two bytes per port update
+  uint8_t _ctrl;  // Control lines as last updated
+  uint8_t _low;   // First port byte of the update in progress
+};
+
+#endif // _HostBackpack_H_
@@ -0,0 +1,26 @@
+/**
+ * @file HostCounters.h
+ * @brief Bus activity recorded by the host Arduino core, for benchmarks.
+ */
+
+#ifndef _HostCounters_H_
+#define _HostCounters_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t i2cTransactions; // endTransmission() and requestFrom() calls
+  uint32_t i2cBytes;        // Bytes on the wire, address bytes included
+  uint32_t spiBytes;        // Bytes shifted out on SPI
+  uint32_t gpioWrites;      // digitalWrite() calls
+  uint32_t gpioToggles;     // digitalWrite() calls that changed the pin level
+  uint32_t waitMicros;      // Time spent in delay() and delayMicroseconds()
+} host_counters_t;
+
+extern host_counters_t hostCounters;
+
+/** @brief Zero all the counters */
+void hostResetCounters();
+
+#endif // _HostCounters_H_
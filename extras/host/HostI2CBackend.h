@@ -0,0 +1,70 @@
+/**
+ * @file HostI2CBackend.h
+ * @brief Host version of an interrupt driven I2C master for I2C_IO::setBackend().
+ *
+ * start() returns at once and the transfer runs on the simulated clock without
+ * holding the caller. It completes in the first poll() once micros() has passed
+ * its bus time, like an interrupt firing at the end of it. The bytes then read
+ * back through Wire as if it had written them.
+ */
+
+#ifndef _HostI2CBackend_H_
+#define _HostI2CBackend_H_
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "HostCounters.h"
+#include "I2C_IO.h"
+
+class HostI2CBackend : public I2C_IOBackend
+{
+public:
+  HostI2CBackend() : _port(NULL), _status(0), _transfers(0) {};
+
+  bool start(I2C_IO *port, uint8_t i2cAddr, const uint8_t *data, uint8_t size)
+  {
+    if (_port != NULL)
+    {
+      return false;
+    }
+    _port = port;
+    _address = i2cAddr;
+    _last = (size > 0) ? data[size - 1] : 0xFF;
+    _doneAt = micros() + Wire.busMicros(1 + size);
+    _transfers++;
+    hostCounters.i2cTransactions++;
+    hostCounters.i2cBytes += 1 + size;
+    return true;
+  };
+
+  void poll()
+  {
+    if ((_port != NULL) && ((long)(micros() - _doneAt) >= 0))
+    {
+      I2C_IO *port = _port;
+
+      _port = NULL;
+      Wire.setEcho(_address, _last);
+      port->complete(_status);
+    }
+  };
+
+  /** @brief A transfer is on the bus */
+  bool busy() { return (_port != NULL); };
+
+  /** @brief Status the next transfers complete with, 0 (default) or a NACK code */
+  void setStatus(uint8_t status) { _status = status; };
+
+  /** @brief Transfers started so far */
+  uint32_t transfers() { return _transfers; };
+
+private:
+  I2C_IO *_port;      // Port of the transfer on the bus, NULL when idle
+  uint8_t _address;
+  uint8_t _last;      // Last byte of the transfer
+  uint8_t _status;
+  uint32_t _doneAt;   // micros() the transfer ends at
+  uint32_t _transfers;
+};
+
+#endif // _HostI2CBackend_H_
@@ -0,0 +1,47 @@
+/**
+ * @file Print.h
+ * @brief Host version of the Arduino Print class, the subset the LCD library and sketches use.
+ */
+
+#ifndef _HostPrint_H_
+#define _HostPrint_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return (str == NULL) ? 0 : write((const uint8_t *)str, strlen(str)); }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+  size_t print(const char str[]) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+
+  size_t println(void) { return write("\r\n"); }
+  size_t println(const char str[]) { return print(str) + println(); }
+  size_t println(char c) { return print(c) + println(); }
+  size_t println(int n, int base = DEC) { return print(n, base) + println(); }
+  size_t println(unsigned int n, int base = DEC) { return print(n, base) + println(); }
+  size_t println(long n, int base = DEC) { return print(n, base) + println(); }
+  size_t println(unsigned long n, int base = DEC) { return print(n, base) + println(); }
+
+  virtual void flush() {}
+};
+
+#endif // _HostPrint_H_
@@ -0,0 +1,53 @@
+/**
+ * @file SPI.h
+ * @brief Host version of the Arduino SPI library: no device answers, reads return 0xFF.
+ *
+ * Transfers advance the simulated clock by their duration at the transaction clock.
+ */
+
+#ifndef _HostSPI_H_
+#define _HostSPI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings
+{
+public:
+  SPISettings() : _clock(4000000) {};
+  SPISettings(uint32_t clock, uint8_t, uint8_t) : _clock(clock) {};
+
+private:
+  uint32_t _clock;
+
+  friend class SPIClass;
+};
+
+class SPIClass
+{
+public:
+  SPIClass() : _clock(4000000) {};
+
+  void begin();
+  void end();
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+
+  uint8_t transfer(uint8_t data);
+  void transfer(void *buffer, size_t size);
+
+private:
+  uint32_t _clock; // SCK frequency in Hz
+};
+
+extern SPIClass SPI;
+
+#endif // _HostSPI_H_
@@ -0,0 +1,77 @@
+/**
+ * @file Wire.h
+ * @brief Host version of the Arduino Wire library: every address acknowledges, reads
+ * return the last byte written to the address (a PCF8574 with nothing pulling its pins),
+ * or the last two for an even number of bytes (a PCF8575).
+ *
+ * Transfers advance the simulated clock by their duration on the bus.
+ */
+
+#ifndef _HostWire_H_
+#define _HostWire_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BUFFER_LENGTH 32
+
+/** @brief Host only: sees each byte a device receives, see TwoWire::setMonitor()
+ *
+ *  @param index Position of the byte in its transmission, the address byte excluded
+ */
+typedef void (*host_wire_monitor_t)(void *context, uint8_t address, uint8_t index, uint8_t value);
+
+class TwoWire
+{
+public:
+  TwoWire();
+
+  void begin();
+  void setClock(uint32_t clock);
+
+  /** @brief Host only: fastest clock the simulated wiring carries, 0 (default) for any.
+   *  Above it transfers aren't acknowledged and reads return nothing.
+   */
+  void setMaxClock(uint32_t clock) { _maxClock = clock; };
+
+  /** @brief Host only: time a transfer of bytes (address byte included) takes on the bus */
+  uint32_t busMicros(uint8_t bytes);
+
+  /** @brief Host only: make reads from address return value, as if it had been written */
+  void setEcho(uint8_t address, uint8_t value) { _echo[address & 0x7F] = value * 0x0101; };
+
+  /** @brief Host only: call monitor with every byte written, NULL for none
+   *
+   *  Each call is made with micros() at the end of the byte's acknowledge, when
+   *  an expander updates its pins, so a model behind it sees the bus timing.
+   */
+  void setMonitor(host_wire_monitor_t monitor, void *context = NULL);
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *data, size_t size);
+  uint8_t endTransmission(bool sendStop = true);
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+
+private:
+  uint8_t _address;
+  uint8_t _txLength;
+  uint8_t _rxLength;
+  uint8_t _rxIndex;
+  bool _rxPairs;      // Even number of bytes requested, read back as port pairs
+  uint8_t _txBuffer[BUFFER_LENGTH]; // Transmission in progress
+  uint16_t _echo[128]; // Last two bytes written to each address, the last one high
+  uint32_t _clock;    // SCL frequency in Hz
+  uint32_t _maxClock; // 0 or the fastest clock that works
+  host_wire_monitor_t _monitor;
+  void *_monitorContext;
+
+  bool overclocked() { return (_maxClock != 0) && (_clock > _maxClock); };
+};
+
+extern TwoWire Wire;
+
+#endif // _HostWire_H_